@@ -0,0 +1,432 @@
+// Micro-benchmarks for the cipher and scoring hot paths.
+//
+//   cipher_bench [--json FILE] [--sizes 64,1024,...] [--min-time SECONDS]
+//                [--filter SUBSTR] [--scowl DIR]
+//
+// Every benchmark runs at several input sizes and reports ns/op, bytes/sec
+// and heap allocations per call. A table goes to stderr and JSON to stdout
+// (or --json FILE) so runs can be diffed against each other.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../is/exp3/caesar_crack.hpp"
+#include "../is/exp3/crack_cache.hpp"
+#include "../is/exp3/crib_search.hpp"
+#include "../is/exp3/vigenere.hpp"
+#include "../is/exp4/cipher_plan.hpp"
+#include "../is/exp4/exp4_stages.hpp"
+#include "../is/exp4/text_layout.hpp"
+
+#ifndef CIPHER_BENCH_SCOWL_DIR
+#define CIPHER_BENCH_SCOWL_DIR "is/exp3/scowl-2020.12.07/final"
+#endif
+
+// ------------------ Allocation counting ------------------
+
+static std::atomic<uint64_t> gAllocations{0};
+
+// Kept out of line: once inlined, GCC 12 pairs malloc/free with new/delete
+// and reports false -Wmismatched-new-delete warnings.
+__attribute__((noinline)) void *operator new(size_t n) {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t n) { return operator new(n); }
+__attribute__((noinline)) void operator delete(void *p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void *p) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept { std::free(p); }
+__attribute__((noinline)) void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+// ------------------ Harness ------------------
+
+struct BenchResult {
+    std::string name;
+    size_t size = 0;         // input bytes (or SCOWL level for dictionary loads)
+    uint64_t iterations = 0;
+    double nsPerOp = 0.0;
+    double bytesPerSec = 0.0;
+    double allocsPerOp = 0.0;
+};
+
+// Keys recovered out of trials, for comparing cracking strategies.
+struct AccuracyResult {
+    std::string name;
+    size_t size = 0;
+    size_t trials = 0;
+    size_t correct = 0;
+};
+
+struct BenchConfig {
+    std::vector<size_t> sizes = {64, 1024, 16384, 262144};
+    double minTime = 0.2;
+    std::string filter;
+    std::string scowlDir = CIPHER_BENCH_SCOWL_DIR;
+    std::string jsonPath;
+};
+
+static const char *const VIGENERE_BENCH_KEY = "laboratory";
+
+static volatile size_t gSink; // keeps results observable
+
+// Run fn until at least minTime has elapsed in one timed batch.
+template <class Fn>
+BenchResult runBench(const std::string &name, size_t size, size_t bytesPerOp, double minTime, Fn &&fn) {
+    gSink = fn(); // warm-up
+    uint64_t iters = 1;
+    for (;;) {
+        uint64_t allocs0 = gAllocations.load(std::memory_order_relaxed);
+        auto t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < iters; ++i) gSink = fn();
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        uint64_t allocs = gAllocations.load(std::memory_order_relaxed) - allocs0;
+        if (secs >= minTime || iters >= (1ull << 40)) {
+            BenchResult r;
+            r.name = name;
+            r.size = size;
+            r.iterations = iters;
+            r.nsPerOp = secs * 1e9 / static_cast<double>(iters);
+            r.bytesPerSec = secs > 0 ? static_cast<double>(bytesPerOp) * static_cast<double>(iters) / secs : 0.0;
+            r.allocsPerOp = static_cast<double>(allocs) / static_cast<double>(iters);
+            return r;
+        }
+        // Aim a little past minTime on the next batch.
+        double scale = secs > 0 ? 1.4 * minTime / secs : 10.0;
+        iters = static_cast<uint64_t>(static_cast<double>(iters) * std::min(std::max(scale, 2.0), 100.0));
+    }
+}
+
+// ------------------ Inputs ------------------
+
+// Deterministic English-like text: common words, some capitals and punctuation.
+static std::string makeEnglishText(size_t n, uint64_t seed = 42) {
+    static const char *WORDS[] = {
+        "the", "of", "and", "to", "a", "in", "is", "it", "that", "for", "on", "with", "as", "was",
+        "he", "be", "this", "have", "from", "or", "by", "not", "but", "what", "all", "were", "when",
+        "cipher", "message", "attack", "at", "dawn", "students", "laboratory", "security", "key",
+        "frequency", "analysis", "secret", "letter", "alphabet", "shift", "dictionary", "english",
+        "morning", "people", "number", "water", "history", "question", "government", "between"};
+    const size_t nWords = sizeof(WORDS) / sizeof(WORDS[0]);
+    std::string s;
+    s.reserve(n + 16);
+    uint64_t state = seed;
+    bool sentenceStart = true;
+    while (s.size() < n) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        std::string w = WORDS[(state >> 33) % nWords];
+        if (sentenceStart) w[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(w[0])));
+        s += w;
+        sentenceStart = ((state >> 20) & 15) == 0;
+        s += sentenceStart ? ". " : (((state >> 24) & 31) == 0 ? ", " : " ");
+    }
+    s.resize(n);
+    return s;
+}
+
+static std::string lettersOnlyUpper(const std::string &s) {
+    return sanitize_text(s);
+}
+
+// A new empty file in $TMPDIR (default /tmp), created by mkstemp so runs
+// never share or clobber a fixed path. Empty string on failure.
+static std::string makeTempFile(const char *stem) {
+    const char *dir = std::getenv("TMPDIR");
+    std::string path = std::string(dir && *dir ? dir : "/tmp") + "/" + stem + ".XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd < 0) return std::string();
+    close(fd);
+    return path;
+}
+
+static uint64_t fileBytes(const std::vector<std::string> &files) {
+    uint64_t total = 0;
+    struct stat st;
+    for (const auto &f : files) {
+        if (stat(f.c_str(), &st) == 0) total += static_cast<uint64_t>(st.st_size);
+    }
+    return total;
+}
+
+// Crack `trials` texts of n bytes under assorted keys; count the right keys.
+template <class Crack>
+AccuracyResult runAccuracy(const std::string &name, size_t n, bool stripSpaces, Crack &&crack) {
+    AccuracyResult r;
+    r.name = name;
+    r.size = n;
+    r.trials = std::min<size_t>(200, std::max<size_t>(8, (1u << 20) / n));
+    std::string cipher;
+    for (size_t t = 0; t < r.trials; ++t) {
+        std::string text = makeEnglishText(n, 1000 + t);
+        if (stripSpaces) text = lettersOnlyUpper(text);
+        int key = static_cast<int>(t * 7 % 25) + 1;
+        caesarTransformInto(text, key, cipher);
+        if (crack(cipher) == key) ++r.correct;
+    }
+    return r;
+}
+
+// ------------------ Output ------------------
+
+static void printRow(const BenchResult &r) {
+    std::fprintf(stderr, "%-34s %9zu %12.1f ns/op %10.2f MB/s %8.2f allocs/op\n", r.name.c_str(), r.size,
+                 r.nsPerOp, r.bytesPerSec / 1e6, r.allocsPerOp);
+}
+
+static void printAccuracyRow(const AccuracyResult &r) {
+    std::fprintf(stderr, "%-34s %9zu %8zu trials %6.1f%% correct\n", r.name.c_str(), r.size, r.trials,
+                 100.0 * static_cast<double>(r.correct) / static_cast<double>(r.trials));
+}
+
+static std::string toJson(const std::vector<BenchResult> &results, const std::vector<AccuracyResult> &accuracy,
+                          const std::string &kernel, size_t dictWords) {
+    std::ostringstream os;
+    os.precision(6);
+    os << "{\n  \"caesar_kernel\": \"" << kernel << "\",\n  \"dict_words\": " << dictWords
+       << ",\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult &r = results[i];
+        os << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size << ", \"iterations\": " << r.iterations
+           << ", \"ns_per_op\": " << std::fixed << r.nsPerOp << ", \"bytes_per_sec\": " << r.bytesPerSec
+           << ", \"allocs_per_op\": " << r.allocsPerOp << std::defaultfloat << "}"
+           << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    os << "  ],\n  \"accuracy\": [\n";
+    for (size_t i = 0; i < accuracy.size(); ++i) {
+        const AccuracyResult &r = accuracy[i];
+        os << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size << ", \"trials\": " << r.trials
+           << ", \"correct\": " << r.correct << "}" << (i + 1 < accuracy.size() ? ",\n" : "\n");
+    }
+    os << "  ]\n}\n";
+    return os.str();
+}
+
+static void printUsage(const char *prog) {
+    std::cerr << "Usage: " << prog
+              << " [--json FILE] [--sizes 64,1024,...] [--min-time SECONDS] [--filter SUBSTR] [--scowl DIR]\n";
+}
+
+static bool parseSizes(const std::string &list, std::vector<size_t> &out) {
+    out.clear();
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        char *end = nullptr;
+        unsigned long long v = std::strtoull(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || v == 0) return false;
+        out.push_back(static_cast<size_t>(v));
+    }
+    return !out.empty();
+}
+
+int main(int argc, char **argv) {
+    BenchConfig cfg;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--json" && hasValue) cfg.jsonPath = argv[++i];
+        else if (arg == "--min-time" && hasValue) cfg.minTime = std::atof(argv[++i]);
+        else if (arg == "--filter" && hasValue) cfg.filter = argv[++i];
+        else if (arg == "--scowl" && hasValue) cfg.scowlDir = argv[++i];
+        else if (arg == "--sizes" && hasValue) {
+            if (!parseSizes(argv[++i], cfg.sizes)) { printUsage(argv[0]); return 2; }
+        }
+        else { printUsage(argv[0]); return 2; }
+    }
+
+    std::vector<BenchResult> results;
+    auto wanted = [&](const std::string &name) {
+        return cfg.filter.empty() || name.find(cfg.filter) != std::string::npos;
+    };
+    auto add = [&](BenchResult r) {
+        printRow(r);
+        results.push_back(std::move(r));
+    };
+
+    // Dictionary loading against the real SCOWL lists, by size level.
+    std::vector<std::string> probe = listScowlFiles(cfg.scowlDir, 95);
+    bool haveScowl = !probe.empty();
+    if (!haveScowl) std::cerr << "SCOWL lists not found in " << cfg.scowlDir << "; using the built-in dictionary.\n";
+    if (haveScowl && wanted("loadDictFile")) {
+        for (int level : {35, 60, 95}) {
+            size_t bytes = static_cast<size_t>(fileBytes(listScowlFiles(cfg.scowlDir, level)));
+            add(runBench("loadDictFile", static_cast<size_t>(level), bytes, cfg.minTime,
+                         [&] { return loadDictFile(cfg.scowlDir, level).size(); }));
+        }
+    }
+    // The same lists compiled to a snapshot and mapped back (one probe so a page is touched).
+    if (haveScowl && wanted("loadDictSnapshot")) {
+        std::string snap = makeTempFile("cipher_bench_dict");
+        if (snap.empty()) std::cerr << "Cannot create a temporary file for the snapshot benchmark.\n";
+        for (int level : {35, 60, 95}) {
+            if (snap.empty()) break;
+            std::string err;
+            if (!writeDictSnapshot(loadDictFile(cfg.scowlDir, level), snap, level, cfg.scowlDir, err)) {
+                std::cerr << err << '\n';
+                break;
+            }
+            size_t bytes = static_cast<size_t>(fileBytes({snap}));
+            add(runBench("loadDictSnapshot", static_cast<size_t>(level), bytes, cfg.minTime, [&] {
+                ScowlIndex d;
+                std::string e;
+                loadDictSnapshot(snap, d, e);
+                return d.size() + d.contains("the");
+            }));
+        }
+        if (!snap.empty()) unlink(snap.c_str());
+    }
+
+    ScowlIndex dict = haveScowl ? loadDictFile(cfg.scowlDir, 95) : tinyBuiltinDict();
+    ShiftInvariantIndex shiftIndex = buildShiftIndex(dict);
+    CrackOptions voteOpts{CrackStrategy::Vote, &shiftIndex};
+    CrackOptions sampleOpts{CrackStrategy::Sample, nullptr};
+    CaesarNgramModel ngrams;
+    trainCaesarNgramModel(ngrams, dict);
+    CrackOptions ngramOpts{CrackStrategy::Ngram, nullptr, &ngrams};
+    std::vector<AccuracyResult> accuracy;
+    CribAutomaton cribs({"attack", " the ", "at dawn", "laboratory"});
+    CipherPlan plan("SECURITY", {3, 1, 4, 2});
+    const std::vector<int> transpositionKey = {3, 1, 4, 2};
+    auto subTables = generate_substitution_key("SECURITY");
+
+    for (size_t n : cfg.sizes) {
+        std::string text = makeEnglishText(n);
+        std::string cipher = caesarTransform(text, 7);
+        std::string vigCipher = vigenereTransform(text, VIGENERE_BENCH_KEY);
+        std::string upper = lettersOnlyUpper(text);
+        std::string transposed = transpose_encrypt(upper, transpositionKey);
+        std::string planCipher = plan.encrypt(text);
+
+        if (wanted("caesarTransform"))
+            add(runBench("caesarTransform", n, n, cfg.minTime, [&] { return caesarTransform(text, 7).size(); }));
+        if (wanted("caesarTransformInto")) {
+            std::string buf;
+            add(runBench("caesarTransformInto", n, n, cfg.minTime, [&] {
+                caesarTransformInto(text, 7, buf);
+                return buf.size();
+            }));
+        }
+        if (wanted("chiSquareForText"))
+            add(runBench("chiSquareForText", n, n, cfg.minTime,
+                         [&] { return static_cast<size_t>(chiSquareForText(text)); }));
+        if (wanted("splitWordsLower"))
+            add(runBench("splitWordsLower", n, n, cfg.minTime, [&] { return splitWordsLower(text).size(); }));
+        if (wanted("scorePlaintext"))
+            add(runBench("scorePlaintext", n, n, cfg.minTime,
+                         [&] { return static_cast<size_t>(scorePlaintext(text, dict).matches); }));
+        if (wanted("pickBestCandidate/decrypt"))
+            add(runBench("pickBestCandidate/decrypt", n, n, cfg.minTime,
+                         [&] { return static_cast<size_t>(pickBestCandidate(cipher, dict).key); }));
+        if (wanted("pickBestCandidate/vote"))
+            add(runBench("pickBestCandidate/vote", n, n, cfg.minTime,
+                         [&] { return static_cast<size_t>(pickBestCandidate(cipher, dict, voteOpts).key); }));
+        if (wanted("pickBestCandidate/cached")) {
+            // Same message under a different shift each call: every call after the first is a hit.
+            CrackCache cache;
+            std::vector<std::string> rotations;
+            for (int k = 0; k < 26; ++k) rotations.push_back(caesarTransform(text, k));
+            size_t call = 0;
+            add(runBench("pickBestCandidate/cached", n, n, cfg.minTime, [&] {
+                const std::string &c = rotations[call++ % 26];
+                return static_cast<size_t>(cache.crack(c, [&](const std::string &m) { return pickBestCandidate(m, dict); }).key);
+            }));
+        }
+        if (wanted("pickBestCandidate/sample"))
+            add(runBench("pickBestCandidate/sample", n, n, cfg.minTime,
+                         [&] { return static_cast<size_t>(pickBestCandidate(cipher, dict, sampleOpts).key); }));
+        if (wanted("pickBestCandidate/ngram"))
+            add(runBench("pickBestCandidate/ngram", n, n, cfg.minTime,
+                         [&] { return static_cast<size_t>(pickBestCandidate(cipher, dict, ngramOpts).key); }));
+        if (wanted("findCribs"))
+            add(runBench("findCribs", n, n, cfg.minTime,
+                         [&] { return findCribs(cribs, cipher.data(), 0, cipher.size()).size(); }));
+        // Word scoring against n-gram scoring, with and without spaces.
+        for (bool strip : {false, true}) {
+            for (const auto &[name, opts] : {std::pair<const char *, const CrackOptions *>{"decrypt", nullptr},
+                                              {"ngram", &ngramOpts}}) {
+                std::string label = std::string("accuracy/") + name + (strip ? "/nospace" : "");
+                if (!wanted(label)) continue;
+                accuracy.push_back(runAccuracy(label, n, strip, [&](const std::string &c) {
+                    return opts ? pickBestCandidate(c, dict, *opts).key : pickBestCandidate(c, dict).key;
+                }));
+                printAccuracyRow(accuracy.back());
+            }
+        }
+        if (wanted("vigenereTransform"))
+            add(runBench("vigenereTransform", n, n, cfg.minTime,
+                         [&] { return vigenereTransform(text, VIGENERE_BENCH_KEY).size(); }));
+        if (wanted("crackVigenere"))
+            add(runBench("crackVigenere", n, n, cfg.minTime,
+                         [&] { return crackVigenere(vigCipher, dict).key.size(); }));
+
+        if (wanted("exp4/substitution_encrypt"))
+            add(runBench("exp4/substitution_encrypt", n, upper.size(), cfg.minTime,
+                         [&] { return substitution_encrypt(upper, subTables.first).size(); }));
+        if (wanted("exp4/transpose_encrypt"))
+            add(runBench("exp4/transpose_encrypt", n, upper.size(), cfg.minTime,
+                         [&] { return transpose_encrypt(upper, transpositionKey).size(); }));
+        if (wanted("exp4/transpose_encrypt_into")) {
+            std::string buf;
+            add(runBench("exp4/transpose_encrypt_into", n, upper.size(), cfg.minTime, [&] {
+                transpose_encrypt_into(upper, transpositionKey, buf);
+                return buf.size();
+            }));
+        }
+        if (wanted("exp4/transpose_decrypt"))
+            add(runBench("exp4/transpose_decrypt", n, transposed.size(), cfg.minTime,
+                         [&] { return transpose_decrypt(transposed, transpositionKey).size(); }));
+        if (wanted("exp4/transpose_decrypt_into")) {
+            std::string buf;
+            add(runBench("exp4/transpose_decrypt_into", n, transposed.size(), cfg.minTime, [&] {
+                transpose_decrypt_into(transposed, transpositionKey, buf);
+                return buf.size();
+            }));
+        }
+        if (wanted("exp4/reinsert_spacing"))
+            add(runBench("exp4/reinsert_spacing", n, n, cfg.minTime,
+                         [&] { return reinsert_spacing(text, transposed).size(); }));
+        if (wanted("exp4/TextLayout")) {
+            add(runBench("exp4/TextLayout", n, n, cfg.minTime, [&] { return TextLayout(text).memory_bytes(); }));
+            TextLayout layout(text);
+            add(runBench("exp4/TextLayout::restore", n, n, cfg.minTime,
+                         [&] { return layout.restore(transposed).size(); }));
+        }
+        if (wanted("exp4/CipherPlan::encrypt"))
+            add(runBench("exp4/CipherPlan::encrypt", n, n, cfg.minTime, [&] { return plan.encrypt(text).size(); }));
+        if (wanted("exp4/CipherPlan::encrypt_into")) {
+            std::string buf;
+            add(runBench("exp4/CipherPlan::encrypt_into", n, n, cfg.minTime, [&] {
+                plan.encrypt_into(text, buf);
+                return buf.size();
+            }));
+        }
+        if (wanted("exp4/CipherPlan::decrypt"))
+            add(runBench("exp4/CipherPlan::decrypt", n, planCipher.size(), cfg.minTime,
+                         [&] { return plan.decrypt(planCipher).size(); }));
+    }
+
+    std::string json = toJson(results, accuracy, caesarKernel().name, dict.size());
+    if (cfg.jsonPath.empty() || cfg.jsonPath == "-") {
+        std::cout << json;
+    } else {
+        std::ofstream out(cfg.jsonPath);
+        if (!(out << json)) {
+            std::cerr << "Cannot write " << cfg.jsonPath << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
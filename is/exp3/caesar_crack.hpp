@@ -0,0 +1,481 @@
+#pragma once
+// Caesar cracking core shared by casesar_scowl and the benchmarks:
+// transforms, tokenization, dictionary loading, chi-square and
+// dictionary scoring, and candidate selection over all 26 keys.
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <sys/stat.h>
+
+#include "caesar_kernel.hpp"
+#include "crack_stats.hpp"
+#include "dict_snapshot.hpp"
+#include "ngram_scorer.hpp"
+#include "scratch_arena.hpp"
+#include "scowl_index.hpp"
+#include "shift_index.hpp"
+#include "word_tokens.hpp"
+
+// ------------------ Helpers ------------------
+// normalizeKey / shiftChar live in caesar_kernel.hpp
+
+//Apply Caesar transform (positive key = forward/encrypt)
+inline void caesarTransformInto(std::string_view s, int key, std::string &out) {
+    caesarShiftInto(s, key, out);
+}
+
+inline std::string caesarTransform(const std::string &s, int key) {
+    std::string out;
+    caesarTransformInto(s, key, out);
+    return out;
+}
+
+// decryptWithKey into a caller buffer of n bytes (no allocation).
+inline void decryptWithKeyInto(const char *cipher, size_t n, int k, char *out) {
+    CRACK_STAT_SCOPE(Decrypt);
+    CRACK_STAT_ADD(DecryptedBytes, n);
+    caesarShift(cipher, out, n, 26 - normalizeKey(k));
+}
+
+// decryptWithKey into out (resized; its capacity is reused across calls).
+inline void decryptWithKeyInto(std::string_view cipher, int k, std::string &out) {
+    out.resize(cipher.size());
+    decryptWithKeyInto(cipher.data(), cipher.size(), k, &out[0]);
+}
+
+//decrypt with given encryption-key 
+inline std::string decryptWithKey(const std::string &cipher, int k) {
+    std::string out;
+    decryptWithKeyInto(cipher, k, out);
+    return out;
+}
+
+// Tokenization & dictionary
+
+// Split text into lowercase words (keep letters and digits as part of words)
+inline std::vector<std::string> splitWordsLower(const std::string &s) {
+    std::vector<std::string> words;
+    forEachWordLower(s.data(), s.size(), [&](std::string_view w) { words.emplace_back(w); });
+    return words;
+}
+
+// Load dictionary file (one word per line). Keep only alphabetic characters, lowercase.
+// A directory is taken to be SCOWL final/: every list up to maxLevel is indexed
+// with its size level and category. A dict_snapshot file is mapped as is
+// (its level was fixed when it was built, so maxLevel does not apply); if it
+// is damaged the result is empty and err, if given, says why.
+inline ScowlIndex loadDictFile(const std::string &path, int maxLevel = 95, std::string *err = nullptr) {
+    CRACK_STAT_SCOPE(LoadDict);
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        return buildScowlIndex(listScowlFiles(path, maxLevel));
+    }
+    if (isDictSnapshot(path)) {
+        ScowlIndex dict;
+        std::string why;
+        if (!loadDictSnapshot(path, dict, why) && err) *err = why;
+        return dict;
+    }
+    return buildScowlIndex({path});
+}
+
+// small builtin fallback
+inline ScowlIndex tinyBuiltinDict() {
+    ScowlIndex::Builder b;
+    for (const char *w : {"the","and","to","of","in","is","it","that","for","on","with","as",
+                          "this","be","are","or","not","you","he","she","they","we","have",
+                          "has","but","all","can","if","so","one","about","there","what","when",
+                          "where","who","how","why","which","hello","world","i","a","an"}) {
+        b.add(w, ScowlEntry{0, SCOWL_WORDS});
+    }
+    return b.build();
+}
+
+// Very common words for tie-break heuristic (an index, so a string_view
+// probes it without building a std::string)
+inline const ScowlIndex COMMON_WORDS = [] {
+    ScowlIndex::Builder b;
+    for (const char *w : {"the","and","to","of","in","is","it","that","for","on","with","as"}) b.add(w);
+    return b.build();
+}();
+
+// ------------------ Letter-frequency chi-square ------------------
+// English expected frequencies (percent)
+// source: standard English frequency table (stable for this use)
+inline const double EN_FREQ_PERCENT[26] = {
+    8.167, 1.492, 2.782, 4.253, 12.702, 2.228, 2.015, 6.094, 6.966,
+    0.153, 0.772, 4.025, 2.406, 6.749, 7.507, 1.929, 0.095, 5.987,
+    6.327, 9.056, 2.758, 0.978, 2.360, 0.150, 1.974, 0.074
+};
+
+// chi2 of a letter histogram against English, reading counts rotated by
+// `rot`: letter i of the text is counts[(i + rot) % 26]. Rotating the
+// ciphertext histogram by the decryption key gives the plaintext's chi2
+// without ever materializing the plaintext.
+inline double chiSquareFromCounts(const LetterCounts &counts, int rot = 0) {
+    uint64_t totalLetters = 0;
+    for (uint64_t c : counts) totalLetters += c;
+    if (totalLetters == 0) return 1e9; // no letters -> extremely bad
+
+    double chi2 = 0.0;
+    for (int i = 0; i < 26; ++i) {
+        double expected = EN_FREQ_PERCENT[i] * static_cast<double>(totalLetters) / 100.0;
+        double observed = static_cast<double>(counts[(i + rot) % 26]);
+        double diff = observed - expected;
+        // if expected is 0 (shouldn't happen), skip
+        if (expected > 0.0) chi2 += diff * diff / expected;
+    }
+    return chi2;
+}
+
+inline double chiSquareForText(const std::string &text) {
+    CRACK_STAT_SCOPE(ChiSquare);
+    LetterCounts counts{};
+    letterHistogram(text.data(), text.size(), counts);
+    return chiSquareFromCounts(counts);
+}
+
+// chi2 of decryptWithKey(cipher, k) for every k, from a single histogram pass.
+inline std::array<double,26> chiSquareAllKeys(const std::string &cipher) {
+    CRACK_STAT_SCOPE(ChiSquare);
+    LetterCounts counts{};
+    letterHistogram(cipher.data(), cipher.size(), counts);
+    std::array<double,26> chi{};
+    for (int k = 0; k < 26; ++k) chi[k] = chiSquareFromCounts(counts, k);
+    return chi;
+}
+
+// ------------------ Scoring & candidate structure ------------------
+
+struct Score {
+    int matches = 0;        // dictionary word matches count
+    int totalWords = 0;
+    int commonHits = 0;     // hits among very common words
+    double ratio = 0.0;     // matches / totalWords
+    double chi2 = 1e9;      // lower is better
+    double ngram = 0.0;     // bigram+trigram log10 probability per letter (Ngram strategy only)
+};
+
+// Dictionary part of the score only; chi2 is left for the caller.
+// Words are probed straight from the tokenizer's views: no allocation.
+inline Score scoreWords(std::string_view pt, const ScowlIndex &dict) {
+    Score s;
+    ScratchSpan lower(pt.size());
+    lowerWordChars(pt.data(), pt.size(), lower.data());
+    {
+        CRACK_STAT_SCOPE(DictProbe);
+        s.totalWords = static_cast<int>(forEachSeparatedWord(lower.data(), pt.size(), [&](std::string_view w) {
+            // dictionary contains only alphabetic words; if candidate has digits too, dictionary won't match.
+            if (dict.contains(w)) s.matches++;
+            if (COMMON_WORDS.contains(w)) s.commonHits++;
+        }));
+    }
+    if (s.totalWords == 0) return s;
+    CRACK_STAT_ADD(DictHits, s.matches);
+    CRACK_STAT_ADD(DictMisses, s.totalWords - s.matches);
+    s.ratio = static_cast<double>(s.matches) / s.totalWords;
+    return s;
+}
+
+inline Score scorePlaintext(const std::string &pt, const ScowlIndex &dict) {
+    Score s = scoreWords(pt, dict);
+    s.chi2 = chiSquareForText(pt);
+    return s;
+}
+
+struct Candidate {
+    int key = -1;
+    std::string plaintext;
+    Score score;
+    Score runnerUp;         // best other key's score (default Score if none was scored)
+};
+
+// ------------------ Cracker ------------------
+
+// Below this many bytes every key is dictionary-scored; letter statistics
+// are too noisy on short texts to drop keys by chi2 alone.
+inline const size_t CRACK_FULL_SCAN_BYTES = 4096;
+// Above it, at most this many lowest-chi2 keys are decrypted and scored,
+// and only those within CRACK_CHI2_MARGIN x the best chi2.
+inline const int CRACK_FINALISTS = 4;
+inline const double CRACK_CHI2_MARGIN = 2.0;
+
+// Primary selection: highest ratio. Tie-break: more commonHits, then more matches, then lower chi2 (closer to English).
+inline bool isBetterCandidate(const Score &sc, int key, const Candidate &best) {
+    if (best.key < 0) return true;
+    if (sc.ratio > best.score.ratio) return true;
+    if (std::fabs(sc.ratio - best.score.ratio) >= 1e-12) return false;
+    if (sc.commonHits != best.score.commonHits) return sc.commonHits > best.score.commonHits;
+    if (sc.matches != best.score.matches) return sc.matches > best.score.matches;
+    // prefer smaller chi2 (closer to english by letter frequency)
+    if (sc.chi2 < best.score.chi2) return true;
+    return std::fabs(sc.chi2 - best.score.chi2) < 1e-9 && key < best.key;
+}
+
+// How pickBestCandidate produces the per-key scores.
+//  Decrypt: decrypt each (finalist) key and look its words up in dict.
+//  Vote:    tokenize the ciphertext once and look every word up in the
+//           shift-invariant index; yields the exact same Score for all 26
+//           keys, then only the winner is decrypted.
+//  Sample:  score a growing prefix window, dropping keys that can no longer
+//           catch the leader; the Score covers the window only, and only
+//           the winner is decrypted in full.
+//  Ngram:   rank keys by letter bigram/trigram log-probability, ignoring
+//           word boundaries; only the winner is decrypted and
+//           dictionary-scored, for the reported Score (runnerUp carries
+//           chi2 and ngram only).
+enum class CrackStrategy { Decrypt, Vote, Sample, Ngram };
+
+struct CrackOptions {
+    CrackStrategy strategy = CrackStrategy::Decrypt;
+    const ShiftInvariantIndex *shiftIndex = nullptr; // required for Vote
+    const CaesarNgramModel *ngrams = nullptr;         // required for Ngram
+};
+
+inline ShiftInvariantIndex buildShiftIndex(const ScowlIndex &dict) {
+    std::vector<std::string> common;
+    COMMON_WORDS.forEach([&](std::string_view w, ScowlEntry) { common.emplace_back(w); });
+    return ShiftInvariantIndex(dict, common);
+}
+
+inline Candidate pickBestCandidateByVote(const std::string &cipher, const ShiftInvariantIndex &idx) {
+    std::array<double,26> chi = chiSquareAllKeys(cipher);
+    ShiftVotes votes = tallyShiftVotes(cipher, idx);
+
+    Candidate best, second;
+    for (int key = 0; key < 26; ++key) {
+        Score sc;
+        sc.totalWords = votes.totalWords;
+        sc.matches = votes.matches[key];
+        sc.commonHits = votes.commonHits[key];
+        if (sc.totalWords > 0) sc.ratio = static_cast<double>(sc.matches) / sc.totalWords;
+        sc.chi2 = chi[key];
+        if (isBetterCandidate(sc, key, best)) {
+            second.key = best.key;
+            second.score = best.score;
+            best.key = key;
+            best.score = sc;
+        } else if (isBetterCandidate(sc, key, second)) {
+            second.key = key;
+            second.score = sc;
+        }
+    }
+    best.runnerUp = second.score;
+    best.plaintext = decryptWithKey(cipher, best.key);
+    return best;
+}
+
+// Sample strategy: first window, and the chance we accept of pruning a key
+// whose full-text ratio would have beaten the leader's.
+inline const size_t CRACK_SAMPLE_START_BYTES = 512;
+inline const double CRACK_SAMPLE_DELTA = 1e-3;
+
+// First position at or after `from` that does not split a word.
+inline size_t sampleBoundary(const std::string &s, size_t from) {
+    if (from >= s.size()) return s.size();
+    while (from < s.size() && std::isalnum(static_cast<unsigned char>(s[from]))) ++from;
+    return from;
+}
+
+// Window [0, w) doubles until one key is left. After each step, keys whose
+// ratio trails the leader's by more than twice the Hoeffding half-width
+// sqrt(ln(26/delta) / 2n) over n window words are dropped; once the window
+// reaches CRACK_FULL_SCAN_BYTES the chi2 finalist rule of the Decrypt
+// strategy applies to the window as well. Every key's counts are kept
+// incrementally, so each byte is scored once per live key.
+inline Candidate pickBestCandidateBySample(const std::string &cipher, const ScowlIndex &dict) {
+    std::array<Score,26> acc{};
+    std::array<bool,26> alive;
+    alive.fill(true);
+    int aliveCount = 26;
+    bool chiPruned = false;
+    LetterCounts counts{};
+    size_t done = 0;
+    auto bestAlive = [&] {
+        Candidate lead;
+        for (int key = 0; key < 26; ++key) {
+            if (alive[key] && isBetterCandidate(acc[key], key, lead)) {
+                lead.key = key;
+                lead.score = acc[key];
+            }
+        }
+        return lead.key;
+    };
+    auto drop = [&](int key) {
+        alive[key] = false;
+        --aliveCount;
+    };
+
+    int leader = 0;
+    for (size_t target = CRACK_SAMPLE_START_BYTES;; target = done * 2) {
+        size_t end = sampleBoundary(cipher, target);
+        const char *segment = cipher.data() + done;
+        size_t segmentLen = end - done;
+        {
+            CRACK_STAT_SCOPE(ChiSquare);
+            letterHistogram(segment, segmentLen, counts);
+        }
+        ScratchSpan pt(segmentLen);
+        for (int key = 0; key < 26; ++key) {
+            if (!alive[key]) continue;
+            CRACK_STAT_KEY_SCOPE(key);
+            decryptWithKeyInto(segment, segmentLen, key, pt.data());
+            Score part = scoreWords(std::string_view(pt.data(), segmentLen), dict);
+            Score &sc = acc[key];
+            sc.matches += part.matches;
+            sc.totalWords += part.totalWords;
+            sc.commonHits += part.commonHits;
+            if (sc.totalWords > 0) sc.ratio = static_cast<double>(sc.matches) / sc.totalWords;
+            sc.chi2 = chiSquareFromCounts(counts, key);
+        }
+        done = end;
+        leader = bestAlive();
+        if (done == cipher.size()) break;
+
+        // Every key sees the same words, so n is shared.
+        int n = acc[leader].totalWords;
+        if (n > 0) {
+            double slack = 2.0 * std::sqrt(std::log(26.0 / CRACK_SAMPLE_DELTA) / (2.0 * n));
+            for (int key = 0; key < 26; ++key) {
+                if (alive[key] && acc[key].ratio + slack < acc[leader].ratio) drop(key);
+            }
+        }
+        if (!chiPruned && done >= CRACK_FULL_SCAN_BYTES && aliveCount > 1) {
+            chiPruned = true;
+            std::array<int,26> order;
+            std::iota(order.begin(), order.end(), 0);
+            auto last = std::remove_if(order.begin(), order.end(), [&](int k) { return !alive[k]; });
+            std::sort(order.begin(), last, [&](int a, int b) {
+                return acc[a].chi2 < acc[b].chi2 || (acc[a].chi2 == acc[b].chi2 && a < b);
+            });
+            for (auto k = order.begin() + 1; k != last; ++k) {
+                if (k - order.begin() >= CRACK_FINALISTS || acc[*k].chi2 > acc[order[0]].chi2 * CRACK_CHI2_MARGIN) drop(*k);
+            }
+            leader = bestAlive();
+        }
+        if (aliveCount == 1) break;
+    }
+
+    Candidate best, second;
+    best.key = leader;
+    best.score = acc[leader];
+    for (int key = 0; key < 26; ++key) {
+        if (key != leader && isBetterCandidate(acc[key], key, second)) {
+            second.key = key;
+            second.score = acc[key];
+        }
+    }
+    best.runnerUp = second.score;
+    best.plaintext = decryptWithKey(cipher, leader);
+    return best;
+}
+
+// Ngram strategy: higher log-probability per letter wins, then lower chi2.
+// Above CRACK_FULL_SCAN_BYTES only the chi2 finalists are scored, as in
+// the Decrypt strategy.
+inline Candidate pickBestCandidateByNgram(const std::string &cipher, const ScowlIndex &dict,
+                                          const CaesarNgramModel &model) {
+    std::array<double,26> chi = chiSquareAllKeys(cipher);
+    ScratchSpan letterBuf(cipher.size());
+    uint8_t *letters = reinterpret_cast<uint8_t *>(letterBuf.data());
+    size_t n = ngramLetters(cipher.data(), cipher.size(), letters);
+
+    std::array<int,26> order;
+    std::iota(order.begin(), order.end(), 0);
+    int finalists = 26;
+    if (cipher.size() >= CRACK_FULL_SCAN_BYTES) {
+        finalists = CRACK_FINALISTS;
+        std::partial_sort(order.begin(), order.begin() + finalists, order.end(),
+                     [&](int a, int b) { return chi[a] < chi[b] || (chi[a] == chi[b] && a < b); });
+        while (finalists > 1 && chi[order[finalists - 1]] > chi[order[0]] * CRACK_CHI2_MARGIN) --finalists;
+    }
+
+    int best = -1, second = -1;
+    std::array<double,26> perLetter{};
+    auto better = [&](int a, int b) {
+        if (b < 0) return true;
+        if (perLetter[a] != perLetter[b]) return perLetter[a] > perLetter[b];
+        if (chi[a] != chi[b]) return chi[a] < chi[b];
+        return a < b;
+    };
+    {
+        CRACK_STAT_SCOPE(NgramScore);
+        for (int i = 0; i < finalists; ++i) {
+            int key = order[i];
+            perLetter[key] = n > 0 ? ngramScoreForKey(letters, n, key, model) / static_cast<double>(n) : 0.0;
+            if (better(key, best)) {
+                second = best;
+                best = key;
+            } else if (better(key, second)) {
+                second = key;
+            }
+        }
+    }
+
+    Candidate c;
+    c.key = best;
+    c.plaintext = decryptWithKey(cipher, best);
+    c.score = scoreWords(c.plaintext, dict);
+    c.score.chi2 = chi[best];
+    c.score.ngram = perLetter[best];
+    if (second >= 0) {
+        c.runnerUp.chi2 = chi[second];
+        c.runnerUp.ngram = perLetter[second];
+    }
+    return c;
+}
+
+// One histogram pass ranks all 26 keys by chi2; only the finalists are
+// decrypted and dictionary-scored.
+inline Candidate pickBestCandidate(const std::string &cipher, const ScowlIndex &dict, const CrackOptions &opts = {}) {
+    CRACK_STAT_ADD(Messages, 1);
+    CRACK_STAT_ADD(CipherBytes, cipher.size());
+    if (opts.strategy == CrackStrategy::Vote && opts.shiftIndex) {
+        return pickBestCandidateByVote(cipher, *opts.shiftIndex);
+    }
+    if (opts.strategy == CrackStrategy::Sample) return pickBestCandidateBySample(cipher, dict);
+    if (opts.strategy == CrackStrategy::Ngram && opts.ngrams) return pickBestCandidateByNgram(cipher, dict, *opts.ngrams);
+    std::array<double,26> chi = chiSquareAllKeys(cipher);
+
+    std::array<int,26> order;
+    std::iota(order.begin(), order.end(), 0);
+    int finalists = 26;
+    if (cipher.size() >= CRACK_FULL_SCAN_BYTES) {
+        finalists = CRACK_FINALISTS;
+        std::partial_sort(order.begin(), order.begin() + finalists, order.end(),
+                     [&](int a, int b) { return chi[a] < chi[b] || (chi[a] == chi[b] && a < b); });
+        while (finalists > 1 && chi[order[finalists - 1]] > chi[order[0]] * CRACK_CHI2_MARGIN) --finalists;
+        std::sort(order.begin(), order.begin() + finalists);
+    }
+
+    // Candidates are decrypted into scratch; only the winner gets a string.
+    Candidate best, second;
+    ScratchSpan pt(cipher.size());
+    for (int i = 0; i < finalists; ++i) {
+        int key = order[i];
+        CRACK_STAT_KEY_SCOPE(key);
+        decryptWithKeyInto(cipher.data(), cipher.size(), key, pt.data());
+        Score sc = scoreWords(std::string_view(pt.data(), cipher.size()), dict);
+        sc.chi2 = chi[key];
+        if (isBetterCandidate(sc, key, best)) {
+            second.key = best.key;
+            second.score = best.score;
+            best.key = key;
+            best.score = sc;
+        } else if (isBetterCandidate(sc, key, second)) {
+            second.key = key;
+            second.score = sc;
+        }
+    }
+    best.runnerUp = second.score;
+    best.plaintext = decryptWithKey(cipher, best.key);
+    return best;
+}
@@ -0,0 +1,329 @@
+#pragma once
+// Shared Caesar kernels used by exp3, exp3p1 and casesar_scowl.
+// caesarShift shifts only ASCII letters and preserves case, exactly like the
+// original per-char loops; letterHistogram counts letters case-insensitively.
+// On x86 with GCC/Clang the widest available SIMD path (AVX-512BW, AVX2,
+// SSE2) is picked once at runtime; everything else uses the scalar loops.
+
+#include <cctype>
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CAESAR_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+//Normalize key into 0..25
+inline int normalizeKey(int k) {
+    return (k % 26 + 26) % 26;
+}
+
+//Shift a single alphabetic char by key (0..25). Non-letters unchanged.
+inline char shiftChar(char ch, int key) {
+    unsigned char uch = static_cast<unsigned char>(ch);
+    if (!isalpha(uch)) return ch;
+    char base = isupper(uch) ? 'A' : 'a';
+    int idx = (static_cast<int>(uch) - base + key) % 26;
+    return static_cast<char>(base + idx);
+}
+
+// Reference path: one byte at a time. key must already be normalized.
+inline void caesarShiftScalar(const char *in, char *out, size_t n, int key) {
+    for (size_t i = 0; i < n; ++i) out[i] = shiftChar(in[i], key);
+}
+
+
+// Case-folded letter index 0..25, or 26 for anything that is not a letter.
+inline const std::array<uint8_t, 256> &letterIndexTable() {
+    static const std::array<uint8_t, 256> t = [] {
+        std::array<uint8_t, 256> a{};
+        for (int c = 0; c < 256; ++c) {
+            a[c] = isalpha(c) ? static_cast<uint8_t>(tolower(c) - 'a') : 26;
+        }
+        return a;
+    }();
+    return t;
+}
+
+using LetterCounts = std::array<uint64_t, 26>;
+
+// Reference histogram; adds into counts. Four sub-tables break the
+// store-to-load dependency on runs of the same letter.
+inline void letterHistogramScalar(const char *p, size_t n, LetterCounts &counts) {
+    const auto &idx = letterIndexTable();
+    uint64_t sub[4][27] = {};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        sub[0][idx[static_cast<unsigned char>(p[i])]]++;
+        sub[1][idx[static_cast<unsigned char>(p[i + 1])]]++;
+        sub[2][idx[static_cast<unsigned char>(p[i + 2])]]++;
+        sub[3][idx[static_cast<unsigned char>(p[i + 3])]]++;
+    }
+    for (; i < n; ++i) sub[0][idx[static_cast<unsigned char>(p[i])]]++;
+    for (int j = 0; j < 26; ++j) counts[j] += sub[0][j] + sub[1][j] + sub[2][j] + sub[3][j];
+}
+
+#ifdef CAESAR_KERNEL_X86
+
+// Per-lane rule shared by every width:
+//   t     = (c | 0x20) - 'a'          letter index when c is a letter
+//   alpha = t <= 25 (unsigned)
+//   wrap  = t >= 26 - key
+//   out   = c + (alpha ? key - (wrap ? 26 : 0) : 0)
+
+__attribute__((target("sse2")))
+inline size_t caesarShiftSSE2(const char *in, char *out, size_t n, int key) {
+    const __m128i lowerBit = _mm_set1_epi8(0x20);
+    const __m128i aVec = _mm_set1_epi8('a');
+    const __m128i maxIdx = _mm_set1_epi8(25);
+    const __m128i wrapAt = _mm_set1_epi8(static_cast<char>(26 - key));
+    const __m128i keyVec = _mm_set1_epi8(static_cast<char>(key));
+    const __m128i wrapDelta = _mm_set1_epi8(static_cast<char>(key - 26));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        __m128i t = _mm_sub_epi8(_mm_or_si128(c, lowerBit), aVec);
+        __m128i alpha = _mm_cmpeq_epi8(_mm_min_epu8(t, maxIdx), t);
+        __m128i wrap = _mm_cmpeq_epi8(_mm_max_epu8(t, wrapAt), t);
+        __m128i delta = _mm_or_si128(_mm_and_si128(wrap, wrapDelta), _mm_andnot_si128(wrap, keyVec));
+        c = _mm_add_epi8(c, _mm_and_si128(alpha, delta));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), c);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+inline size_t caesarShiftAVX2(const char *in, char *out, size_t n, int key) {
+    const __m256i lowerBit = _mm256_set1_epi8(0x20);
+    const __m256i aVec = _mm256_set1_epi8('a');
+    const __m256i maxIdx = _mm256_set1_epi8(25);
+    const __m256i wrapAt = _mm256_set1_epi8(static_cast<char>(26 - key));
+    const __m256i keyVec = _mm256_set1_epi8(static_cast<char>(key));
+    const __m256i wrapDelta = _mm256_set1_epi8(static_cast<char>(key - 26));
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+        __m256i t = _mm256_sub_epi8(_mm256_or_si256(c, lowerBit), aVec);
+        __m256i alpha = _mm256_cmpeq_epi8(_mm256_min_epu8(t, maxIdx), t);
+        __m256i wrap = _mm256_cmpeq_epi8(_mm256_max_epu8(t, wrapAt), t);
+        __m256i delta = _mm256_blendv_epi8(keyVec, wrapDelta, wrap);
+        c = _mm256_add_epi8(c, _mm256_and_si256(alpha, delta));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), c);
+    }
+    return i;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline size_t caesarShiftAVX512(const char *in, char *out, size_t n, int key) {
+    const __m512i lowerBit = _mm512_set1_epi8(0x20);
+    const __m512i aVec = _mm512_set1_epi8('a');
+    const __m512i maxIdx = _mm512_set1_epi8(25);
+    const __m512i wrapAt = _mm512_set1_epi8(static_cast<char>(26 - key));
+    const __m512i keyVec = _mm512_set1_epi8(static_cast<char>(key));
+    const __m512i wrapDelta = _mm512_set1_epi8(static_cast<char>(key - 26));
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i c = _mm512_loadu_si512(in + i);
+        __m512i t = _mm512_sub_epi8(_mm512_or_si512(c, lowerBit), aVec);
+        __mmask64 alpha = _mm512_cmple_epu8_mask(t, maxIdx);
+        __mmask64 wrap = _mm512_cmpge_epu8_mask(t, wrapAt);
+        __m512i delta = _mm512_mask_blend_epi8(wrap, keyVec, wrapDelta);
+        c = _mm512_mask_add_epi8(c, alpha, c, delta);
+        _mm512_storeu_si512(out + i, c);
+    }
+    return i;
+}
+
+// Histograms: per letter, compare every lane against the letter index and
+// subtract the all-ones mask from a byte accumulator. Accumulators are
+// flushed through psadbw before they can overflow (255 vectors).
+// SSE2/AVX2 do the alphabet in two halves of 13 to stay within registers;
+// the half re-reads a block that is still in L1.
+
+__attribute__((target("sse2")))
+inline size_t letterHistogramSSE2(const char *p, size_t n, LetterCounts &counts) {
+    const __m128i lowerBit = _mm_set1_epi8(0x20);
+    const __m128i aVec = _mm_set1_epi8('a');
+    const __m128i zero = _mm_setzero_si128();
+    size_t vecs = n / 16;
+    for (size_t b = 0; b < vecs; b += 255) {
+        size_t e = std::min(vecs, b + 255);
+        for (int half = 0; half < 26; half += 13) {
+            __m128i acc[13];
+#pragma GCC unroll 13
+            for (int j = 0; j < 13; ++j) acc[j] = zero;
+            for (size_t v = b; v < e; ++v) {
+                __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + v * 16));
+                __m128i t = _mm_sub_epi8(_mm_or_si128(c, lowerBit), aVec);
+#pragma GCC unroll 13
+                for (int j = 0; j < 13; ++j) {
+                    acc[j] = _mm_sub_epi8(acc[j], _mm_cmpeq_epi8(t, _mm_set1_epi8(static_cast<char>(half + j))));
+                }
+            }
+#pragma GCC unroll 13
+            for (int j = 0; j < 13; ++j) {
+                __m128i s = _mm_sad_epu8(acc[j], zero);
+                counts[half + j] += static_cast<uint64_t>(_mm_cvtsi128_si64(s)) +
+                                    static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(s, s)));
+            }
+        }
+    }
+    return vecs * 16;
+}
+
+__attribute__((target("avx2")))
+inline size_t letterHistogramAVX2(const char *p, size_t n, LetterCounts &counts) {
+    const __m256i lowerBit = _mm256_set1_epi8(0x20);
+    const __m256i aVec = _mm256_set1_epi8('a');
+    const __m256i zero = _mm256_setzero_si256();
+    size_t vecs = n / 32;
+    for (size_t b = 0; b < vecs; b += 255) {
+        size_t e = std::min(vecs, b + 255);
+        for (int half = 0; half < 26; half += 13) {
+            __m256i acc[13];
+#pragma GCC unroll 13
+            for (int j = 0; j < 13; ++j) acc[j] = zero;
+            for (size_t v = b; v < e; ++v) {
+                __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + v * 32));
+                __m256i t = _mm256_sub_epi8(_mm256_or_si256(c, lowerBit), aVec);
+#pragma GCC unroll 13
+                for (int j = 0; j < 13; ++j) {
+                    acc[j] = _mm256_sub_epi8(acc[j], _mm256_cmpeq_epi8(t, _mm256_set1_epi8(static_cast<char>(half + j))));
+                }
+            }
+#pragma GCC unroll 13
+            for (int j = 0; j < 13; ++j) {
+                __m256i s = _mm256_sad_epu8(acc[j], zero);
+                counts[half + j] += static_cast<uint64_t>(_mm256_extract_epi64(s, 0)) +
+                                    static_cast<uint64_t>(_mm256_extract_epi64(s, 1)) +
+                                    static_cast<uint64_t>(_mm256_extract_epi64(s, 2)) +
+                                    static_cast<uint64_t>(_mm256_extract_epi64(s, 3));
+            }
+        }
+    }
+    return vecs * 32;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline size_t letterHistogramAVX512(const char *p, size_t n, LetterCounts &counts) {
+    const __m512i lowerBit = _mm512_set1_epi8(0x20);
+    const __m512i aVec = _mm512_set1_epi8('a');
+    const __m512i one = _mm512_set1_epi8(1);
+    const __m512i zero = _mm512_setzero_si512();
+    size_t vecs = n / 64;
+    for (size_t b = 0; b < vecs; b += 255) {
+        size_t e = std::min(vecs, b + 255);
+        __m512i acc[26];
+#pragma GCC unroll 26
+        for (int j = 0; j < 26; ++j) acc[j] = zero;
+        for (size_t v = b; v < e; ++v) {
+            __m512i c = _mm512_loadu_si512(p + v * 64);
+            __m512i t = _mm512_sub_epi8(_mm512_or_si512(c, lowerBit), aVec);
+#pragma GCC unroll 26
+            for (int j = 0; j < 26; ++j) {
+                __mmask64 m = _mm512_cmpeq_epi8_mask(t, _mm512_set1_epi8(static_cast<char>(j)));
+                acc[j] = _mm512_mask_add_epi8(acc[j], m, acc[j], one);
+            }
+        }
+#pragma GCC unroll 26
+        for (int j = 0; j < 26; ++j) {
+            alignas(64) uint64_t lanes[8];
+            _mm512_store_si512(lanes, _mm512_sad_epu8(acc[j], zero));
+            for (uint64_t l : lanes) counts[j] += l;
+        }
+    }
+    return vecs * 64;
+}
+
+#endif // CAESAR_KERNEL_X86
+
+using CaesarShiftFn = size_t (*)(const char *, char *, size_t, int);
+using LetterHistogramFn = size_t (*)(const char *, size_t, LetterCounts &);
+
+// Each bulk routine handles a prefix and returns how many bytes it did;
+// nullptr means scalar only.
+struct CaesarKernel {
+    const char *name;
+    CaesarShiftFn shift;
+    LetterHistogramFn histogram;
+};
+
+// Resolved once on first use.
+inline const CaesarKernel &caesarKernel() {
+    static const CaesarKernel k = [] {
+#ifdef CAESAR_KERNEL_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512bw")) return CaesarKernel{"avx512", &caesarShiftAVX512, &letterHistogramAVX512};
+        if (__builtin_cpu_supports("avx2")) return CaesarKernel{"avx2", &caesarShiftAVX2, &letterHistogramAVX2};
+        if (__builtin_cpu_supports("sse2")) return CaesarKernel{"sse2", &caesarShiftSSE2, &letterHistogramSSE2};
+#endif
+        return CaesarKernel{"scalar", nullptr, nullptr};
+    }();
+    return k;
+}
+
+//Shift n bytes from in to out (may alias exactly). Any key is accepted.
+inline void caesarShift(const char *in, char *out, size_t n, int key) {
+    key = normalizeKey(key);
+    const CaesarKernel &k = caesarKernel();
+    size_t done = k.shift ? k.shift(in, out, n, key) : 0;
+    caesarShiftScalar(in + done, out + done, n - done, key);
+}
+
+// Buffer-reusing forms. *Into resizes out to the input size and writes
+// there, so a caller that keeps out around allocates only when a longer
+// message than any before comes along; out must not overlap in.
+// *InPlace transforms the string's own bytes.
+inline void caesarShiftInto(std::string_view in, int key, std::string &out) {
+    out.resize(in.size());
+    caesarShift(in.data(), &out[0], in.size(), key);
+}
+
+inline void caesarShiftInPlace(std::string &s, int key) {
+    caesarShift(s.data(), &s[0], s.size(), key);
+}
+
+inline std::string caesarShift(const std::string &s, int key) {
+    std::string out;
+    caesarShiftInto(s, key, out);
+    return out;
+}
+
+// Inputs at least this big are split across hardware threads.
+constexpr size_t LETTER_HISTOGRAM_PARALLEL_MIN = 4u << 20;
+
+// Case-insensitive a..z counts of p[0, n), added into counts.
+inline void letterHistogram(const char *p, size_t n, LetterCounts &counts) {
+    unsigned threads = std::thread::hardware_concurrency();
+    if (n >= LETTER_HISTOGRAM_PARALLEL_MIN && threads > 1) {
+        size_t per = (n + threads - 1) / threads;
+        std::vector<LetterCounts> partial(threads, LetterCounts{});
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t) {
+            size_t b = std::min(n, t * per), e = std::min(n, b + per);
+            pool.emplace_back([&, t, b, e] {
+                const CaesarKernel &k = caesarKernel();
+                size_t done = k.histogram ? k.histogram(p + b, e - b, partial[t]) : 0;
+                letterHistogramScalar(p + b + done, e - b - done, partial[t]);
+            });
+        }
+        const CaesarKernel &k = caesarKernel();
+        size_t first = std::min(n, per);
+        size_t done = k.histogram ? k.histogram(p, first, partial[0]) : 0;
+        letterHistogramScalar(p + done, first - done, partial[0]);
+        for (auto &th : pool) th.join();
+        for (const auto &part : partial)
+            for (int j = 0; j < 26; ++j) counts[j] += part[j];
+        return;
+    }
+    const CaesarKernel &k = caesarKernel();
+    size_t done = k.histogram ? k.histogram(p, n, counts) : 0;
+    letterHistogramScalar(p + done, n - done, counts);
+}
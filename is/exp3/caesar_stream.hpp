@@ -0,0 +1,278 @@
+#pragma once
+// Constant-memory streaming for the Caesar programs.
+// Regular files are mmap'd and walked in fixed windows; pipes/ttys are read
+// with large buffered reads. Output is written as each chunk is done, so
+// resident memory stays at roughly two chunk buffers whatever the input size.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "caesar_kernel.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+constexpr size_t CAESAR_STREAM_CHUNK = 1 << 20; // 1 MiB
+
+// Read-only whole-file mapping. Empty and non-regular files stay unmapped.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile() { close(); }
+
+    // Returns false if fd does not refer to a non-empty regular file.
+    // sequential=false is for random access (hash tables): no read-behind drop.
+    bool map(int fd, bool sequential = true) {
+#ifndef _WIN32
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) return false;
+        void *p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) return false;
+        madvise(p, static_cast<size_t>(st.st_size), sequential ? MADV_SEQUENTIAL : MADV_WILLNEED);
+        data_ = static_cast<const char *>(p);
+        size_ = static_cast<size_t>(st.st_size);
+        return true;
+#else
+        (void)fd;
+        (void)sequential;
+        return false;
+#endif
+    }
+
+    // Hint that [0, upto) will not be read again so the pages can be dropped.
+    void release(size_t upto) {
+#ifndef _WIN32
+        long page = sysconf(_SC_PAGESIZE);
+        size_t aligned = upto - upto % static_cast<size_t>(page);
+        if (data_ && aligned > 0) madvise(const_cast<char *>(data_), aligned, MADV_DONTNEED);
+#else
+        (void)upto;
+#endif
+    }
+
+    void close() {
+#ifndef _WIN32
+        if (data_) munmap(const_cast<char *>(data_), size_);
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Hands out the input in chunks of at most CAESAR_STREAM_CHUNK bytes.
+// Path "" or "-" means stdin.
+class ChunkedInput {
+public:
+    ChunkedInput() = default;
+    ChunkedInput(const ChunkedInput &) = delete;
+    ChunkedInput &operator=(const ChunkedInput &) = delete;
+    ~ChunkedInput() { close(); }
+
+    bool open(const std::string &path, std::string &err) {
+        close();
+#ifndef _WIN32
+        if (path.empty() || path == "-") {
+            fd_ = 0;
+        } else {
+            fd_ = ::open(path.c_str(), O_RDONLY);
+            if (fd_ < 0) { err = path + ": " + strerror(errno); return false; }
+            ownFd_ = true;
+        }
+        mapped_ = map_.map(fd_);
+#else
+        if (path.empty() || path == "-") {
+            file_ = stdin;
+        } else {
+            file_ = fopen(path.c_str(), "rb");
+            if (!file_) { err = path + ": " + strerror(errno); return false; }
+            ownFile_ = true;
+        }
+#endif
+        if (!mapped_) buf_.resize(CAESAR_STREAM_CHUNK);
+        return true;
+    }
+
+    // Next chunk, or false at end of input / on error (see failed()).
+    bool next(std::string_view &chunk) {
+        if (mapped_) {
+            if (pos_ > 0) map_.release(pos_);
+            if (pos_ >= map_.size()) return false;
+            size_t n = std::min(CAESAR_STREAM_CHUNK, map_.size() - pos_);
+            chunk = std::string_view(map_.data() + pos_, n);
+            pos_ += n;
+            return true;
+        }
+#ifndef _WIN32
+        for (;;) {
+            ssize_t n = ::read(fd_, buf_.data(), buf_.size());
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) { failed_ = true; return false; }
+            if (n == 0) return false;
+            chunk = std::string_view(buf_.data(), static_cast<size_t>(n));
+            return true;
+        }
+#else
+        size_t n = fread(buf_.data(), 1, buf_.size(), file_);
+        if (n == 0) { failed_ = ferror(file_) != 0; return false; }
+        chunk = std::string_view(buf_.data(), n);
+        return true;
+#endif
+    }
+
+    // Writable scratch of chunk size for callers that transform in place.
+    char *scratch() {
+        if (buf_.empty()) buf_.resize(CAESAR_STREAM_CHUNK);
+        return buf_.data();
+    }
+
+    bool isMapped() const { return mapped_; }
+    bool failed() const { return failed_; }
+
+    void close() {
+        map_.close();
+#ifndef _WIN32
+        if (ownFd_) ::close(fd_);
+        fd_ = -1;
+        ownFd_ = false;
+#else
+        if (ownFile_) fclose(file_);
+        file_ = nullptr;
+        ownFile_ = false;
+#endif
+        mapped_ = failed_ = false;
+        pos_ = 0;
+    }
+
+private:
+#ifndef _WIN32
+    int fd_ = -1;
+    bool ownFd_ = false;
+#else
+    FILE *file_ = nullptr;
+    bool ownFile_ = false;
+#endif
+    MappedFile map_;
+    bool mapped_ = false;
+    bool failed_ = false;
+    size_t pos_ = 0;
+    std::vector<char> buf_;
+};
+
+// Unbuffered writer; callers already hand over large chunks.
+// Path "" or "-" means stdout.
+class ChunkedOutput {
+public:
+    ChunkedOutput() = default;
+    ChunkedOutput(const ChunkedOutput &) = delete;
+    ChunkedOutput &operator=(const ChunkedOutput &) = delete;
+    ~ChunkedOutput() { close(); }
+
+    bool open(const std::string &path, std::string &err) {
+        close();
+#ifndef _WIN32
+        if (path.empty() || path == "-") {
+            fd_ = 1;
+        } else {
+            fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd_ < 0) { err = path + ": " + strerror(errno); return false; }
+            ownFd_ = true;
+        }
+#else
+        if (path.empty() || path == "-") {
+            file_ = stdout;
+        } else {
+            file_ = fopen(path.c_str(), "wb");
+            if (!file_) { err = path + ": " + strerror(errno); return false; }
+            ownFile_ = true;
+        }
+#endif
+        return true;
+    }
+
+    bool write(const char *p, size_t n) {
+#ifndef _WIN32
+        while (n > 0) {
+            ssize_t w = ::write(fd_, p, n);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) return false;
+            p += w;
+            n -= static_cast<size_t>(w);
+        }
+        return true;
+#else
+        return fwrite(p, 1, n, file_) == n;
+#endif
+    }
+
+    bool close() {
+        bool ok = true;
+#ifndef _WIN32
+        if (ownFd_) ok = ::close(fd_) == 0;
+        fd_ = -1;
+        ownFd_ = false;
+#else
+        if (file_) ok = fflush(file_) == 0;
+        if (ownFile_) ok = fclose(file_) == 0 && ok;
+        file_ = nullptr;
+        ownFile_ = false;
+#endif
+        return ok;
+    }
+
+private:
+#ifndef _WIN32
+    int fd_ = -1;
+    bool ownFd_ = false;
+#else
+    FILE *file_ = nullptr;
+    bool ownFile_ = false;
+#endif
+};
+
+// Stream inPath through caesarShift(key) into outPath. On failure err says why.
+inline bool caesarTransformStream(const std::string &inPath, const std::string &outPath,
+                                  int key, std::string &err) {
+    ChunkedInput in;
+    ChunkedOutput out;
+    if (!in.open(inPath, err) || !out.open(outPath, err)) return false;
+
+    // mmap'd chunks are read-only, so they need a separate output buffer;
+    // read() chunks already live in the reader's buffer and shift in place.
+    std::vector<char> outBuf(in.isMapped() ? CAESAR_STREAM_CHUNK : 0);
+    std::string_view chunk;
+    while (in.next(chunk)) {
+        char *dst = in.isMapped() ? outBuf.data() : in.scratch();
+        caesarShift(chunk.data(), dst, chunk.size(), key);
+        if (!out.write(dst, chunk.size())) {
+            err = std::string("write failed: ") + strerror(errno);
+            return false;
+        }
+    }
+    if (in.failed()) {
+        err = std::string("read failed: ") + strerror(errno);
+        return false;
+    }
+    if (!out.close()) {
+        err = std::string("close failed: ") + strerror(errno);
+        return false;
+    }
+    return true;
+}
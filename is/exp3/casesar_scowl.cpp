@@ -1,209 +1,579 @@
 #include <bits/stdc++.h>
+#include "caesar_crack.hpp"
+#include "caesar_stream.hpp"
+#include "cli_args.hpp"
+#include "crack_cache.hpp"
+#include "crack_server.hpp"
+#include "crib_search.hpp"
+#include "tiered_dict.hpp"
+#include "vigenere.hpp"
+#include "work_pool.hpp"
 using namespace std;
 
-//Helpers 
-
-//Normalize key
-int normalizeKey(int k) {
-    return (k % 26 + 26) % 26;
+#ifdef CAESAR_STATS
+// Count heap allocations for --stats.
+// Kept out of line: once inlined, GCC 12 pairs malloc/free with new/delete
+// and reports false -Wmismatched-new-delete warnings.
+__attribute__((noinline)) void *operator new(size_t n) {
+    statCountAllocation();
+    if (void *p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
 }
+void *operator new[](size_t n) { return operator new(n); }
+__attribute__((noinline)) void operator delete(void *p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete[](void *p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept { free(p); }
+__attribute__((noinline)) void operator delete[](void *p, size_t) noexcept { free(p); }
+#endif
+
+// ------------------ CLI ------------------
 
-//Shift a single alphabetic char by key (0..25). Non-letters unchanged.
-char shiftChar(char ch, int key) {
-    unsigned char uch = static_cast<unsigned char>(ch);
-    if (!isalpha(uch)) return ch;
-    char base = isupper(uch) ? 'A' : 'a';
-    int idx = (static_cast<int>(uch) - base + key) % 26;
-    return static_cast<char>(base + idx);
+static void printUsage(const char *prog) {
+    cerr << "Usage: " << prog << " [--key K [--decrypt] | --vigenere KEY [--decrypt] | --batch [--threads N] |\n"
+         << "        --crack-vigenere [--max-period N] | --crib TEXT | --cribs FILE | --serve SOCKET]\n"
+         << "        [--dict FILE [--tiered]] [--in FILE] [--out FILE]\n"
+         << "  With no arguments runs the interactive cracker.\n"
+         << "  --key K     stream-transform input with shift K instead of cracking\n"
+         << "  --decrypt   apply the shift backwards (decrypt with encryption key K)\n"
+         << "  --vigenere KEY  stream-transform input with a Vigenere key (letters only)\n"
+         << "  --crack-vigenere  find the Vigenere key of the whole input; key and score\n"
+         << "              go to stderr, plaintext to --out\n"
+         << "  --max-period N  longest Vigenere key tried (default 100)\n"
+         << "  --crib TEXT known plaintext word or phrase (repeatable); finds it under all\n"
+         << "              26 keys in one pass and prints offset/key/crib lines to --out\n"
+         << "              (letters match case-insensitively, any non-letter matches\n"
+         << "              any one non-letter byte)\n"
+         << "  --cribs FILE  one crib per line\n"
+         << "  --dict PATH dictionary file, a SCOWL final/ directory or a dict_snapshot file\n"
+         << "              (default: built-in tiny dict)\n"
+         << "  --max-level N  highest SCOWL size level loaded from a directory (default 95)\n"
+         << "  --tiered    with a SCOWL directory: load only levels <= 20 up front and move\n"
+         << "              to 35, 60, then --max-level (with proper names) for messages\n"
+         << "              whose best key is not confident; larger tiers load on first use\n"
+         << "  --min-ratio R   --tiered: best key's word match ratio needed (default 0.75)\n"
+         << "  --min-margin M  --tiered: lead over the runner-up's ratio needed (default 0.25)\n"
+         << "  --cache N   --batch / --serve: remember the last N results by rotation-\n"
+         << "              canonical ciphertext, so a message re-sent under another\n"
+         << "              shift is answered without rescoring (default 0 = off)\n"
+         << "  --in FILE   input file (default/-: stdin)\n"
+         << "  --out FILE  output file (default/-: stdout)\n"
+         << "  --batch     crack every input line separately on all cores; one\n"
+         << "              key/matches/totalWords/ratio/commonHits/chi2/plaintext\n"
+         << "              tab-separated result line per input line, in order\n"
+         << "  --serve SOCKET  daemon: load the dictionary once and answer crack/encrypt/\n"
+         << "              decrypt requests on a Unix socket (crack_client, crack_loadgen)\n"
+         << "  --report-interval S  --serve: log request rate and p50/p99 latency every S\n"
+         << "              seconds (default 10, 0 = only at shutdown)\n"
+         << "  --threads N worker threads for --batch / --crack-vigenere / --crib / --serve\n"
+         << "              (default: all cores)\n"
+         << "  --strategy decrypt|vote|sample|ngram  decrypt: score decrypted candidates (default)\n"
+         << "              vote: one shift-invariant lookup per ciphertext word\n"
+         << "              sample: score a growing prefix until one key is left; the\n"
+         << "              reported score covers that prefix only\n"
+         << "              ngram: rank keys by letter bigram/trigram statistics learned\n"
+         << "              from the dictionary; needs no spaces between words\n"
+         << "  --stats     print timing/counter JSON to stderr when done (builds with\n"
+         << "              -DCAESAR_STATS only); --batch adds a per-message latency histogram\n"
+         << "  Without --key, --in/--out crack the whole input; the summary goes to stderr.\n";
 }
 
-//Apply Caesar transform (positive key = forward/encrypt)
-string caesarTransform(const string &s, int key) {
-    key = normalizeKey(key);
-    string out;
-    out.reserve(s.size());
-    for (unsigned char c : s) out.push_back(shiftChar(static_cast<char>(c), key));
-    return out;
+// Dictionary from path, or the builtin one if path is empty/unreadable.
+static ScowlIndex loadDictOrBuiltin(const string &path, int maxLevel, ostream &log) {
+    ScowlIndex dict;
+    if (!path.empty()) {
+        string err;
+        dict = loadDictFile(path, maxLevel, &err);
+        if (dict.empty()) {
+            if (!err.empty()) cerr << "Warning: " << err << '\n';
+            cerr << "Warning: could not load dictionary or file empty. Using tiny builtin dictionary.\n";
+            dict = tinyBuiltinDict();
+        } else {
+            log << (dict.external() ? "Mapped dictionary snapshot with " : "Loaded dictionary with ")
+                << dict.size() << " words (" << dict.memoryBytes() / 1024 << " KiB).\n";
+        }
+    } else {
+        dict = tinyBuiltinDict();
+        log << "Using built-in tiny dictionary (" << dict.size() << " words).\n";
+    }
+    return dict;
 }
 
-//decrypt with given encryption-key 
-string decryptWithKey(const string &cipher, int k) {
-    return caesarTransform(cipher, 26 - normalizeKey(k));
+// Settings shared by every cracking mode.
+struct CliConfig {
+    string inPath, outPath, dictPath;
+    int maxLevel = 95;
+    unsigned threads = 0;
+    CrackStrategy strategy = CrackStrategy::Decrypt;
+    bool stats = false;
+    int maxPeriod = 100;
+    bool tiered = false;
+    TierThresholds thresholds;
+    string servePath;
+    double reportSeconds = 10;
+    size_t cacheEntries = 0;
+};
+
+// Loaded dictionary plus whatever the chosen strategy needs on top of it,
+// or the tiered dictionary (which keeps its own per tier).
+// Filled in place because opts points into it.
+struct Cracker {
+    ScowlIndex dict;
+    ShiftInvariantIndex shiftIndex;
+    CaesarNgramModel ngrams;
+    CrackOptions opts;
+    unique_ptr<TieredDict> tiered;
+
+    unique_ptr<CrackCache> cache;
+
+    // tierUsed is only filled in by a real crack, so asking for it skips the cache.
+    Candidate crack(const string &cipher, size_t *tierUsed = nullptr) const {
+        if (cache && !tierUsed) return cache->crack(cipher, [this](const string &c) { return crackUncached(c, nullptr); });
+        return crackUncached(cipher, tierUsed);
+    }
+
+    Candidate crackUncached(const string &cipher, size_t *tierUsed) const {
+        if (tiered) return tiered->crack(cipher, tierUsed);
+        return pickBestCandidate(cipher, dict, opts);
+    }
+};
+
+static void printCacheStats(ostream &os, const Cracker &c) {
+    if (!c.cache) return;
+    CrackCacheStats st = c.cache->stats();
+    os << "Cache: " << st.hits << " hits, " << st.misses << " misses, " << st.evictions << " evictions, "
+       << st.bypassed << " too long, " << st.entries << " entries.\n";
 }
 
-// Tokenization & dictionary
+static bool isDirectory(const string &path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
 
-// Split text into lowercase words (keep letters and digits as part of words)
-vector<string> splitWordsLower(const string &s) {
-    vector<string> words;
-    string cur;
-    cur.reserve(16);
-    for (unsigned char uc : s) {
-        char c = static_cast<char>(tolower(uc));
-        if (isalnum(static_cast<unsigned char>(c))) {
-            cur.push_back(c);
+static void prepareCracker(Cracker &c, const CliConfig &cfg, const string &dictPath, ostream &log) {
+    if (cfg.cacheEntries > 0) {
+        CrackCacheOptions co;
+        co.capacity = cfg.cacheEntries;
+        c.cache = make_unique<CrackCache>(co);
+    }
+    if (cfg.tiered && cfg.strategy == CrackStrategy::Ngram) {
+        cerr << "Warning: --tiered does not apply to --strategy ngram; loading the dictionary as usual.\n";
+    } else if (cfg.tiered) {
+        if (isDirectory(dictPath)) {
+            c.tiered = make_unique<TieredDict>(dictPath, defaultDictTiers(cfg.maxLevel), cfg.strategy,
+                                               cfg.thresholds, &log);
+            if (c.tiered->loadedWords() > 0) return;
+            c.tiered.reset();
+        }
+        cerr << "Warning: --tiered needs a SCOWL final/ directory; loading the dictionary as usual.\n";
+    }
+    c.dict = loadDictOrBuiltin(dictPath, cfg.maxLevel, log);
+    c.opts.strategy = cfg.strategy;
+    if (cfg.strategy == CrackStrategy::Vote) {
+        c.shiftIndex = buildShiftIndex(c.dict);
+        c.opts.shiftIndex = &c.shiftIndex;
+        log << "Built shift-invariant index (" << c.shiftIndex.size() << " forms).\n";
+    }
+    if (cfg.strategy == CrackStrategy::Ngram) {
+        if (trainCaesarNgramModel(c.ngrams, c.dict)) {
+            c.opts.ngrams = &c.ngrams;
+            log << "Trained bigram/trigram model.\n";
         } else {
-            if (!cur.empty()) { words.push_back(move(cur)); cur.clear(); }
+            // An untrained model scores every key 0 and would leave chi2 to rank alone.
+            cerr << "Warning: the dictionary has no common words to train the n-gram model on; using --strategy decrypt.\n";
+            c.opts.strategy = CrackStrategy::Decrypt;
         }
     }
-    if (!cur.empty()) words.push_back(move(cur));
-    return words;
 }
 
-// Load dictionary file (one word per line). Keep only alphabetic characters, lowercase.
-unordered_set<string> loadDictFile(const string &path) {
-    unordered_set<string> dict;
-    ifstream in(path);
-    if (!in) return dict;
-    string w;
-    while (in >> w) {
-        string cleaned;
-        cleaned.reserve(w.size());
-        for (unsigned char uc : w) {
-            char c = static_cast<char>(tolower(uc));
-            if (isalpha(static_cast<unsigned char>(c))) cleaned.push_back(c);
-        }
-        if (!cleaned.empty()) dict.insert(cleaned);
-    }
-    return dict;
+static void printScore(ostream &os, const Candidate &best) {
+    os << "  Score: matches=" << best.score.matches
+       << ", totalWords=" << best.score.totalWords
+       << ", ratio=" << best.score.ratio
+       << ", commonHits=" << best.score.commonHits
+       << ", chi2=" << best.score.chi2 << '\n';
 }
 
-// small builtin fallback
-unordered_set<string> tinyBuiltinDict() {
-    return {"the","and","to","of","in","is","it","that","for","on","with","as",
-            "this","be","are","or","not","you","he","she","they","we","have",
-            "has","but","all","can","if","so","one","about","there","what","when",
-            "where","who","how","why","which","hello","world","i","a","an"};
+static void printTier(ostream &os, const TieredDict &dict, size_t tier) {
+    os << "  Dictionary tier: " << tier << " (level <= " << dict.tierSpec(tier).maxLevel
+       << ", largest loaded tier " << dict.loadedWords() << " words)\n";
 }
 
-// Very common words for tie-break heuristic
-const unordered_set<string> COMMON_WORDS = {
-    "the","and","to","of","in","is","it","that","for","on","with","as"
-};
+// Crack a whole file/pipe: plaintext to outPath, summary to stderr.
+static int crackStream(const CliConfig &cfg) {
+    Cracker cracker;
+    prepareCracker(cracker, cfg, cfg.dictPath, cerr);
 
-// ------------------ Letter-frequency chi-square ------------------
-// English expected frequencies (percent)
-// source: standard English frequency table (stable for this use)
-const double EN_FREQ_PERCENT[26] = {
-    8.167, 1.492, 2.782, 4.253, 12.702, 2.228, 2.015, 6.094, 6.966,
-    0.153, 0.772, 4.025, 2.406, 6.749, 7.507, 1.929, 0.095, 5.987,
-    6.327, 9.056, 2.758, 0.978, 2.360, 0.150, 1.974, 0.074
-};
+    string err, cipher;
+    ChunkedInput in;
+    if (!in.open(cfg.inPath, err)) { cerr << "Error: " << err << '\n'; return 1; }
+    string_view chunk;
+    while (in.next(chunk)) cipher.append(chunk.data(), chunk.size());
+    if (in.failed()) { cerr << "Error: read failed\n"; return 1; }
 
-double chiSquareForText(const string &text) {
-    array<int,26> counts{};
-    int totalLetters = 0;
-    for (unsigned char uc : text) {
-        char c = static_cast<char>(tolower(uc));
-        if (isalpha(static_cast<unsigned char>(c))) {
-            counts[c - 'a']++;
-            totalLetters++;
-        }
-    }
-    if (totalLetters == 0) return 1e9; // no letters -> extremely bad
+    size_t tier = 0;
+    Candidate best = cracker.crack(cipher, &tier);
+    cerr << "Key (encryption shift): " << best.key << '\n';
+    printScore(cerr, best);
+    if (cracker.tiered) printTier(cerr, *cracker.tiered, tier);
 
-    double chi2 = 0.0;
-    for (int i = 0; i < 26; ++i) {
-        double expected = EN_FREQ_PERCENT[i] * totalLetters / 100.0;
-        double observed = static_cast<double>(counts[i]);
-        double diff = observed - expected;
-        // if expected is 0 (shouldn't happen), skip
-        if (expected > 0.0) chi2 += diff * diff / expected;
+    ChunkedOutput out;
+    if (!out.open(cfg.outPath, err) || !out.write(best.plaintext.data(), best.plaintext.size()) || !out.close()) {
+        cerr << "Error: " << (err.empty() ? "write failed" : err) << '\n';
+        return 1;
     }
-    return chi2;
+    return 0;
 }
 
-// ------------------ Scoring & candidate structure ------------------
+// Vigenere-crack a whole file/pipe: plaintext to outPath, key and score to stderr.
+static int crackVigenereStream(const CliConfig &cfg) {
+    ScowlIndex dict = loadDictOrBuiltin(cfg.dictPath, cfg.maxLevel, cerr);
 
-struct Score {
-    int matches = 0;        // dictionary word matches count
-    int totalWords = 0;
-    int commonHits = 0;     // hits among very common words
-    double ratio = 0.0;     // matches / totalWords
-    double chi2 = 1e9;      // lower is better
-};
+    string err, cipher;
+    ChunkedInput in;
+    if (!in.open(cfg.inPath, err)) { cerr << "Error: " << err << '\n'; return 1; }
+    string_view chunk;
+    while (in.next(chunk)) cipher.append(chunk.data(), chunk.size());
+    if (in.failed()) { cerr << "Error: read failed\n"; return 1; }
 
-Score scorePlaintext(const string &pt, const unordered_set<string> &dict) {
-    auto words = splitWordsLower(pt);
-    Score s;
-    s.totalWords = static_cast<int>(words.size());
-    if (s.totalWords == 0) {
-        s.chi2 = chiSquareForText(pt);
-        return s;
-    }
-    for (const auto &w : words) {
-        // dictionary contains only alphabetic words; if candidate has digits too, dictionary won't match.
-        if (dict.find(w) != dict.end()) s.matches++;
-        if (COMMON_WORDS.find(w) != COMMON_WORDS.end()) s.commonHits++;
+    WorkStealingPool pool(cfg.threads);
+    VigenereCrackOptions opts;
+    opts.maxPeriod = cfg.maxPeriod;
+    opts.pool = &pool;
+    auto start = chrono::steady_clock::now();
+    VigenereResult best = crackVigenere(cipher, dict, opts);
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cerr << "Key: " << best.key << " (length " << best.key.size() << ", kappa " << best.kappa << ")\n";
+    Candidate shown;
+    shown.score = best.score;
+    printScore(cerr, shown);
+    cerr << "Cracked in " << secs << " s on " << pool.size() << " threads.\n";
+
+    ChunkedOutput out;
+    if (!out.open(cfg.outPath, err) || !out.write(best.plaintext.data(), best.plaintext.size()) || !out.close()) {
+        cerr << "Error: " << (err.empty() ? "write failed" : err) << '\n';
+        return 1;
     }
-    s.ratio = static_cast<double>(s.matches) / s.totalWords;
-    s.chi2 = chiSquareForText(pt);
-    return s;
+    return 0;
 }
 
-struct Candidate {
-    int key = -1;
-    string plaintext;
-    Score score;
-};
+// Lines cracked per pool round; bounds memory for arbitrarily long batch files.
+const size_t BATCH_BLOCK_LINES = 1 << 16;
+const size_t BATCH_GRAIN = 256;
+
+// Result columns, shared by --batch lines and --serve crack responses:
+// key \t matches \t totalWords \t ratio \t commonHits \t chi2 \t plaintext
+static void appendResultFields(string &out, const Candidate &c) {
+    char buf[160];
+    int n = snprintf(buf, sizeof buf, "%d\t%d\t%d\t%.6g\t%d\t%.6g\t",
+                     c.key, c.score.matches, c.score.totalWords, c.score.ratio,
+                     c.score.commonHits, c.score.chi2);
+    out.append(buf, static_cast<size_t>(n));
+    out += c.plaintext;
+}
+
+// One result line per input line, in input order.
+static void appendBatchResult(string &out, const Candidate &c) {
+    appendResultFields(out, c);
+    out += '\n';
+}
+
+// Crack every line of inPath on all cores; results go to outPath in input order.
+static int crackBatch(const CliConfig &cfg) {
+    Cracker cracker;
+    prepareCracker(cracker, cfg, cfg.dictPath, cerr);
+
+    string err;
+    ChunkedInput in;
+    ChunkedOutput out;
+    if (!in.open(cfg.inPath, err) || !out.open(cfg.outPath, err)) { cerr << "Error: " << err << '\n'; return 1; }
 
-// ------------------ Cracker ------------------
-
-// Primary selection: highest ratio. Tie-break: more commonHits, then more matches, then lower chi2 (closer to English).
-Candidate pickBestCandidate(const string &cipher, const unordered_set<string> &dict) {
-    Candidate best;
-    double bestRatio = -1.0;
-    for (int key = 0; key < 26; ++key) {
-        string pt = decryptWithKey(cipher, key);
-        Score sc = scorePlaintext(pt, dict);
-
-        bool better = false;
-        if (sc.ratio > bestRatio) better = true;
-        else if (fabs(sc.ratio - bestRatio) < 1e-12) {
-            if (sc.commonHits > best.score.commonHits) better = true;
-            else if (sc.commonHits == best.score.commonHits) {
-                if (sc.matches > best.score.matches) better = true;
-                else if (sc.matches == best.score.matches) {
-                    // prefer smaller chi2 (closer to english by letter frequency)
-                    if (sc.chi2 < best.score.chi2) better = true;
-                    else if (fabs(sc.chi2 - best.score.chi2) < 1e-9 && key < best.key) better = true;
-                }
+    WorkStealingPool pool(cfg.threads);
+    vector<string> lines;
+    vector<string> rendered;
+    lines.reserve(BATCH_BLOCK_LINES);
+    size_t total = 0;
+    auto start = chrono::steady_clock::now();
+
+    // Crack the buffered block in parallel, then write it out in order.
+    auto flush = [&]() -> bool {
+        rendered.assign((lines.size() + BATCH_GRAIN - 1) / BATCH_GRAIN, string());
+        pool.parallelFor(lines.size(), BATCH_GRAIN, [&](size_t b, size_t e) {
+            string &dst = rendered[b / BATCH_GRAIN];
+            for (size_t i = b; i < e; ++i) {
+                CRACK_STAT_LATENCY_SCOPE();
+                appendBatchResult(dst, cracker.crack(lines[i]));
             }
+        });
+        for (const string &r : rendered) {
+            if (!out.write(r.data(), r.size())) return false;
+        }
+        total += lines.size();
+        lines.clear();
+        return true;
+    };
+
+    string partial;
+    string_view chunk;
+    bool ok = true;
+    while (ok && in.next(chunk)) {
+        size_t pos = 0;
+        for (size_t nl; ok && (nl = chunk.find('\n', pos)) != string_view::npos; pos = nl + 1) {
+            partial.append(chunk.data() + pos, nl - pos);
+            lines.push_back(move(partial));
+            partial.clear();
+            if (lines.size() == BATCH_BLOCK_LINES) ok = flush();
         }
+        partial.append(chunk.data() + pos, chunk.size() - pos);
+    }
+    if (ok && !partial.empty()) lines.push_back(move(partial));
+    if (ok && !lines.empty()) ok = flush();
+    if (!ok || in.failed() || !out.close()) { cerr << "Error: I/O failed\n"; return 1; }
 
-        if (better) {
-            best.key = key;
-            best.plaintext = move(pt);
-            best.score = sc;
-            bestRatio = sc.ratio;
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cerr << "Cracked " << total << " messages in " << secs << " s on " << pool.size()
+         << " threads (" << (secs > 0 ? total / secs : 0.0) << " msg/s).\n";
+    if (cracker.tiered) {
+        const TieredDict &td = *cracker.tiered;
+        cerr << "Resolved per dictionary tier:";
+        for (size_t i = 0; i < td.tierCount(); ++i) {
+            cerr << ' ' << td.resolvedBy(i) << (td.isLoaded(i) ? "" : " (not loaded)");
         }
+        cerr << " (largest loaded tier: " << td.loadedWords() << " words).\n";
     }
-    return best;
+    printCacheStats(cerr, cracker);
+    return 0;
 }
 
-// ------------------ CLI ------------------
+// Mapped input searched per window so the match list stays bounded.
+const size_t CRIB_WINDOW = 64 << 20;
+
+// One offset \t key \t crib line per match.
+static void appendCribMatch(string &out, const CribAutomaton &ac, const CribMatch &m) {
+    char buf[48];
+    int n = snprintf(buf, sizeof buf, "%llu\t%d\t", static_cast<unsigned long long>(m.offset), m.key);
+    out.append(buf, static_cast<size_t>(n));
+    out += ac.cribs()[m.crib];
+    out += '\n';
+}
+
+// Find every crib under every key in one pass over the input. Regular files
+// are mapped and searched in parallel ranges; pipes are streamed through
+// the automaton chunk by chunk. Matches go to outPath in input order, a
+// per-key summary to stderr.
+static int searchCribs(const CliConfig &cfg, const vector<string> &cribs) {
+    CribAutomaton ac(cribs);
+    if (ac.patterns() == 0) { cerr << "Error: no crib contains a letter\n"; return 2; }
+    cerr << "Crib automaton: " << ac.patterns() << " patterns, " << ac.states() << " states ("
+         << ac.tableBytes() / 1024 << " KiB table).\n";
+
+    string err;
+    ChunkedOutput out;
+    if (!out.open(cfg.outPath, err)) { cerr << "Error: " << err << '\n'; return 1; }
+    vector<uint64_t> perKey(26, 0);
+    uint64_t total = 0, bytes = 0;
+    string rendered;
+    auto emit = [&](const CribMatch &m) {
+        ++perKey[m.key];
+        ++total;
+        appendCribMatch(rendered, ac, m);
+    };
+    auto flush = [&]() {
+        bool ok = out.write(rendered.data(), rendered.size());
+        rendered.clear();
+        return ok;
+    };
+    auto start = chrono::steady_clock::now();
+    bool ok = true;
+    unsigned threads = 1;
+
+    MappedFile map;
+    int fd = cfg.inPath.empty() || cfg.inPath == "-" ? -1 : ::open(cfg.inPath.c_str(), O_RDONLY);
+    if (fd >= 0 && map.map(fd)) {
+        WorkStealingPool pool(cfg.threads);
+        threads = pool.size();
+        bytes = map.size();
+        for (size_t off = 0; ok && off < map.size(); off += CRIB_WINDOW) {
+            size_t end = min(map.size(), off + CRIB_WINDOW);
+            for (const CribMatch &m : findCribs(ac, map.data(), off, end, &pool)) emit(m);
+            ok = flush();
+            if (end > ac.maxLength()) map.release(end - ac.maxLength());
+        }
+    } else {
+        ChunkedInput in;
+        if (!in.open(cfg.inPath, err)) { cerr << "Error: " << err << '\n'; if (fd >= 0) close(fd); return 1; }
+        uint32_t state = CribAutomaton::ROOT;
+        string_view chunk;
+        while (ok && in.next(chunk)) {
+            state = ac.scan(chunk.data(), chunk.size(), state, bytes, emit);
+            bytes += chunk.size();
+            ok = flush();
+        }
+        ok = ok && !in.failed();
+    }
+    if (fd >= 0) close(fd);
+    if (!ok || !out.close()) { cerr << "Error: I/O failed\n"; return 1; }
+
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cerr << total << " matches in " << bytes << " bytes, " << secs << " s on " << threads << " threads ("
+         << (secs > 0 ? bytes / secs / 1e6 : 0.0) << " MB/s).\n";
+    vector<int> keys(26);
+    iota(keys.begin(), keys.end(), 0);
+    stable_sort(keys.begin(), keys.end(), [&](int a, int b) { return perKey[a] > perKey[b]; });
+    cerr << "Implied keys (encryption shift: matches):";
+    for (int k : keys) {
+        if (perKey[k]) cerr << ' ' << k << ": " << perKey[k];
+    }
+    cerr << (total ? "\n" : " none\n");
+    return 0;
+}
+
+// Long-running daemon: the dictionary is loaded once, requests arrive over
+// a Unix socket (see crack_protocol.hpp) and are cracked on the pool.
+static int serveRequests(const CliConfig &cfg) {
+    Cracker cracker;
+    prepareCracker(cracker, cfg, cfg.dictPath, cerr);
+    CrackServerOptions opts;
+    opts.socketPath = cfg.servePath;
+    opts.threads = cfg.threads;
+    opts.reportSeconds = cfg.reportSeconds;
+    int rc = runCrackServer(opts, [&](const CrackRequest &req, string &body) {
+        switch (req.op) {
+        case CRACK_OP_CRACK: {
+            CRACK_STAT_LATENCY_SCOPE();
+            appendResultFields(body, cracker.crack(string(req.text)));
+            return true;
+        }
+        case CRACK_OP_ENCRYPT:
+        case CRACK_OP_DECRYPT: {
+            int key = normalizeKey(req.key); // any int32 from the wire; negating INT32_MIN would overflow
+            caesarShiftInto(req.text, req.op == CRACK_OP_ENCRYPT ? key : 26 - key, body);
+            return true;
+        }
+        default:
+            return false;
+        }
+    }, cerr);
+    printCacheStats(cerr, cracker);
+    return rc;
+}
+
+// Emit --stats JSON (if collected) and pass the exit code through.
+static int finishWithStats(const CliConfig &cfg, int rc) {
+#ifdef CAESAR_STATS
+    if (cfg.stats) cerr << crackStatsJson();
+#else
+    (void)cfg;
+#endif
+    return rc;
+}
+
+// Usage error for an option whose value does not parse or is out of range.
+static int badValue(const char *prog, const string &arg, const char *value) {
+    cerr << "Error: invalid value for " << arg << ": " << value << '\n';
+    printUsage(prog);
+    return 2;
+}
 
-int main() {
+int main(int argc, char **argv) {
+    CRACK_STAT_THREAD_START(); // count allocations from here on, dictionary load included
     ios::sync_with_stdio(false);
     cin.tie(nullptr);
 
-    cout << "Path to SCOWL dictionary (press Enter to use built-in tiny dict):\n> ";
-    string path;
-    getline(cin, path);
+    CliConfig cfg;
+    bool haveKey = false, decrypt = false, batch = false, crackVig = false;
+    string vigenereKey;
+    vector<string> cribs;
+    int streamKey = 0;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--in" && hasValue) cfg.inPath = argv[++i];
+        else if (arg == "--out" && hasValue) cfg.outPath = argv[++i];
+        else if (arg == "--dict" && hasValue) cfg.dictPath = argv[++i];
+        else if (arg == "--key" && hasValue) {
+            if (!parseShiftKey(argv[++i], streamKey)) return badValue(argv[0], arg, argv[i]);
+            haveKey = true;
+        }
+        else if (arg == "--decrypt") decrypt = true;
+        else if (arg == "--batch") batch = true;
+        else if (arg == "--vigenere" && hasValue) vigenereKey = argv[++i];
+        else if (arg == "--crack-vigenere") crackVig = true;
+        else if (arg == "--crib" && hasValue) cribs.push_back(argv[++i]);
+        else if (arg == "--cribs" && hasValue) {
+            ifstream f(argv[++i]);
+            if (!f) { cerr << "Error: cannot read " << argv[i] << '\n'; return 1; }
+            for (string line; getline(f, line);) {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (!line.empty()) cribs.push_back(line);
+            }
+        }
+        else if (arg == "--serve" && hasValue) cfg.servePath = argv[++i];
+        else if (arg == "--report-interval" && hasValue) cfg.reportSeconds = atof(argv[++i]);
+        else if (arg == "--max-period" && hasValue) {
+            if (!parseIntArg(argv[++i], 1, 1 << 20, cfg.maxPeriod)) return badValue(argv[0], arg, argv[i]);
+        }
+        else if (arg == "--stats") cfg.stats = true;
+        else if (arg == "--max-level" && hasValue) {
+            if (!parseIntArg(argv[++i], 0, 100, cfg.maxLevel)) return badValue(argv[0], arg, argv[i]);
+        }
+        else if (arg == "--tiered") cfg.tiered = true;
+        else if (arg == "--cache" && hasValue) {
+            if (!parseIntArg(argv[++i], 0, 1 << 24, cfg.cacheEntries)) return badValue(argv[0], arg, argv[i]);
+        }
+        else if (arg == "--min-ratio" && hasValue) cfg.thresholds.minRatio = atof(argv[++i]);
+        else if (arg == "--min-margin" && hasValue) cfg.thresholds.minMargin = atof(argv[++i]);
+        else if (arg == "--threads" && hasValue) {
+            if (!parseIntArg(argv[++i], 0, MAX_THREADS_ARG, cfg.threads)) return badValue(argv[0], arg, argv[i]);
+        }
+        else if (arg == "--strategy" && hasValue) {
+            string v = argv[++i];
+            if (v == "decrypt") cfg.strategy = CrackStrategy::Decrypt;
+            else if (v == "vote") cfg.strategy = CrackStrategy::Vote;
+            else if (v == "sample") cfg.strategy = CrackStrategy::Sample;
+            else if (v == "ngram") cfg.strategy = CrackStrategy::Ngram;
+            else { printUsage(argv[0]); return 2; }
+        }
+        else { printUsage(argv[0]); return 2; }
+    }
 
-    unordered_set<string> dict;
-    if (!path.empty()) {
-        dict = loadDictFile(path);
-        if (dict.empty()) {
-            cerr << "Warning: could not load dictionary or file empty. Using tiny builtin dictionary.\n";
-            dict = tinyBuiltinDict();
-        } else {
-            cout << "Loaded dictionary with " << dict.size() << " words.\n";
+    // Batch mode: stream the whole input through the given key
+    if (haveKey) {
+        string err;
+        if (!caesarTransformStream(cfg.inPath, cfg.outPath, decrypt ? 26 - normalizeKey(streamKey) : streamKey, err)) {
+            cerr << "Error: " << err << '\n';
+            return 1;
         }
-    } else {
-        dict = tinyBuiltinDict();
-        cout << "Using built-in tiny dictionary (" << dict.size() << " words).\n";
+        return 0;
+    }
+    if (!vigenereKey.empty()) {
+        string err;
+        if (!vigenereTransformStream(cfg.inPath, cfg.outPath, vigenereKey, decrypt, err)) {
+            cerr << "Error: " << err << '\n';
+            return 1;
+        }
+        return 0;
+    }
+    if (decrypt) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    if (cfg.stats && !CRACK_STATS_ENABLED) {
+        cerr << "Warning: --stats needs a build with -DCAESAR_STATS; no statistics collected.\n";
     }
+    if (!cfg.servePath.empty()) return finishWithStats(cfg, serveRequests(cfg));
+    if (!cribs.empty()) return finishWithStats(cfg, searchCribs(cfg, cribs));
+    if (crackVig) return finishWithStats(cfg, crackVigenereStream(cfg));
+    if (batch) return finishWithStats(cfg, crackBatch(cfg));
+    if (!cfg.inPath.empty() || !cfg.outPath.empty()) return finishWithStats(cfg, crackStream(cfg));
+
+    string path = cfg.dictPath;
+    if (argc == 1) {
+        cout << "Path to SCOWL dictionary (press Enter to use built-in tiny dict):\n> ";
+        getline(cin, path);
+    }
+    Cracker cracker;
+    prepareCracker(cracker, cfg, path, cout);
 
     cout << "\nEnter ciphertext (one line). The program will try all 26 keys and auto-pick best.\n> ";
     string cipher;
@@ -216,21 +586,21 @@ int main() {
 
     // Show all 26 decryptions
     cout << "\nAll 26 decryptions (key = encryption shift):\n";
+    string attempt;
     for (int k = 0; k < 26; ++k) {
-        cout << "Key " << setw(2) << k << ": " << decryptWithKey(cipher, k) << '\n';
+        decryptWithKeyInto(cipher, k, attempt);
+        cout << "Key " << setw(2) << k << ": " << attempt << '\n';
     }
 
     // Auto-pick using dictionary scoring + chi-square tie breaking
-    Candidate best = pickBestCandidate(cipher, dict);
+    size_t tier = 0;
+    Candidate best = cracker.crack(cipher, &tier);
 
     cout << "\nBest guess (auto-picked):\n";
     cout << "  Key (encryption shift): " << best.key << '\n';
     cout << "  Plaintext: " << best.plaintext << '\n';
-    cout << "  Score: matches=" << best.score.matches
-         << ", totalWords=" << best.score.totalWords
-         << ", ratio=" << best.score.ratio
-         << ", commonHits=" << best.score.commonHits
-         << ", chi2=" << best.score.chi2 << '\n';
+    printScore(cout, best);
+    if (cracker.tiered) printTier(cout, *cracker.tiered, tier);
 
-    return 0;
+    return finishWithStats(cfg, 0);
 }
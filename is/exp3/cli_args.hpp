@@ -0,0 +1,33 @@
+#pragma once
+// Strict number parsing for command-line options, shared by the exp3 and
+// exp4 programs: the whole argument must be a decimal number inside the
+// option's range. (atoi takes "3x" as 3 and "abc" as 0, and a negative
+// count cast to unsigned becomes four billion.)
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+
+// Upper bound for every --threads option (0 = one per hardware thread).
+constexpr long long MAX_THREADS_ARG = 1024;
+
+// Parse s into out if it is a whole number in [lo, hi]; out is left
+// untouched otherwise.
+template <class T>
+bool parseIntArg(const char *s, long long lo, long long hi, T &out) {
+    errno = 0;
+    char *end = nullptr;
+    long long v = strtoll(s, &end, 10);
+    if (end == s || *end != '\0' || errno == ERANGE || v < lo || v > hi) return false;
+    out = static_cast<T>(v);
+    return true;
+}
+
+// A Caesar shift: any whole number that fits in a long long, reduced mod
+// 26 (sign kept; normalizeKey or the kernels bring it into 0..25).
+inline bool parseShiftKey(const char *s, int &key) {
+    long long k = 0;
+    if (!parseIntArg(s, LLONG_MIN, LLONG_MAX, k)) return false;
+    key = static_cast<int>(k % 26);
+    return true;
+}
@@ -0,0 +1,178 @@
+#pragma once
+// LRU cache of Caesar crack results, shared by concurrent callers.
+// Messages are keyed by their rotation-canonical form: the ciphertext
+// shifted so its first letter becomes 'a'/'A'. Every Caesar shift of a
+// message has the same canonical form, so a message re-sent under another
+// key is a hit; the cached plaintext and score are reused and the key is
+// corrected by the rotation offset. The canonical form is never built:
+// hashing and comparison rotate the bytes on the fly.
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "caesar_crack.hpp"
+
+struct CrackCacheOptions {
+    size_t capacity = 4096;          // entries across all shards; 0 disables the cache
+    size_t maxTextBytes = 64 * 1024; // longer messages bypass the cache
+    unsigned shards = 16;            // independently locked LRU lists
+};
+
+struct CrackCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t bypassed = 0;  // too long to cache
+    size_t entries = 0;
+};
+
+// Rotation that takes the first letter of s to 'a' (0 if s has no letters).
+inline int canonicalRotation(const std::string &s) {
+    for (unsigned char c : s) {
+        if (isalpha(c)) return (tolower(c) - 'a') % 26;
+    }
+    return 0;
+}
+
+class CrackCache {
+public:
+    explicit CrackCache(CrackCacheOptions opts = {}) : opts_(opts) {
+        // Never more shards than entries, and the capacity split exactly
+        // (the first capacity % shards shards take one more), so the cache
+        // holds at most opts.capacity entries in total.
+        if (opts_.capacity > 0 && opts_.capacity < opts_.shards) opts_.shards = static_cast<unsigned>(opts_.capacity);
+        if (opts_.shards == 0) opts_.shards = 1;
+        for (unsigned i = 0; i < opts_.shards; ++i) {
+            shards_.push_back(std::make_unique<Shard>());
+            shards_.back()->capacity = opts_.capacity / opts_.shards + (i < opts_.capacity % opts_.shards ? 1 : 0);
+        }
+    }
+
+    bool enabled() const { return opts_.capacity > 0; }
+
+    // compute(cipher) on a miss; on a hit the cached result with the key
+    // adjusted to this rotation.
+    template <class F>
+    Candidate crack(const std::string &cipher, F compute) {
+        if (!enabled() || cipher.size() > opts_.maxTextBytes) {
+            bypassed_.fetch_add(1, std::memory_order_relaxed);
+            return compute(cipher);
+        }
+        int rot = canonicalRotation(cipher);
+        uint64_t h = canonicalHash(cipher, rot);
+        Shard &shard = *shards_[h % shards_.size()];
+        {
+            std::lock_guard<std::mutex> lock(shard.m);
+            auto it = shard.index.find(h);
+            if (it != shard.index.end() && sameCanonical(it->second->canonical, cipher, rot)) {
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                Candidate c = it->second->result;
+                c.key = normalizeKey(c.key + rot);
+                return c;
+            }
+        }
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        Candidate c = compute(cipher);
+        if (c.key < 0) return c;
+
+        Entry e;
+        e.hash = h;
+        e.canonical = caesarShift(cipher, 26 - rot);
+        e.result = c;
+        e.result.key = normalizeKey(c.key - rot); // key from plaintext to the canonical form
+        std::lock_guard<std::mutex> lock(shard.m);
+        auto it = shard.index.find(h);
+        if (it != shard.index.end()) {
+            // Same hash: keep the newest (another thread may have added it already).
+            shard.lru.erase(it->second);
+            shard.index.erase(it);
+        }
+        shard.lru.push_front(std::move(e));
+        shard.index[h] = shard.lru.begin();
+        while (shard.lru.size() > shard.capacity) {
+            shard.index.erase(shard.lru.back().hash);
+            shard.lru.pop_back();
+            evictions_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return c;
+    }
+
+    CrackCacheStats stats() const {
+        CrackCacheStats s;
+        s.hits = hits_.load(std::memory_order_relaxed);
+        s.misses = misses_.load(std::memory_order_relaxed);
+        s.evictions = evictions_.load(std::memory_order_relaxed);
+        s.bypassed = bypassed_.load(std::memory_order_relaxed);
+        for (const auto &sh : shards_) {
+            std::lock_guard<std::mutex> lock(sh->m);
+            s.entries += sh->lru.size();
+        }
+        return s;
+    }
+
+    void clear() {
+        for (auto &sh : shards_) {
+            std::lock_guard<std::mutex> lock(sh->m);
+            sh->lru.clear();
+            sh->index.clear();
+        }
+    }
+
+private:
+    struct Entry {
+        uint64_t hash = 0;
+        std::string canonical;
+        Candidate result;   // key maps the plaintext to `canonical`
+    };
+    struct Shard {
+        mutable std::mutex m;
+        std::list<Entry> lru;   // most recent first
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+        size_t capacity = 0;
+    };
+
+    // shiftChar as 26 byte tables, one per shift.
+    static const std::array<std::array<char,256>,26> &shiftTables() {
+        static const std::array<std::array<char,256>,26> tables = [] {
+            std::array<std::array<char,256>,26> t{};
+            for (int k = 0; k < 26; ++k) {
+                for (int b = 0; b < 256; ++b) t[k][b] = shiftChar(static_cast<char>(b), k);
+            }
+            return t;
+        }();
+        return tables;
+    }
+
+    // FNV-1a of s rotated back by rot, without materializing it.
+    static uint64_t canonicalHash(const std::string &s, int rot) {
+        const std::array<char,256> &back = shiftTables()[(26 - rot) % 26];
+        uint64_t h = 1469598103934665603ull ^ s.size();
+        for (char c : s) {
+            h ^= static_cast<unsigned char>(back[static_cast<unsigned char>(c)]);
+            h *= 1099511628211ull;
+        }
+        return h ^ (h >> 29);
+    }
+
+    static bool sameCanonical(const std::string &canonical, const std::string &s, int rot) {
+        if (canonical.size() != s.size()) return false;
+        const std::array<char,256> &back = shiftTables()[(26 - rot) % 26];
+        for (size_t i = 0; i < s.size(); ++i) {
+            if (canonical[i] != back[static_cast<unsigned char>(s[i])]) return false;
+        }
+        return true;
+    }
+
+    CrackCacheOptions opts_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<uint64_t> hits_{0}, misses_{0}, evictions_{0}, bypassed_{0};
+};
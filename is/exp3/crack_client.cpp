@@ -0,0 +1,83 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include "cli_args.hpp"
+#include "crack_protocol.hpp"
+using namespace std;
+
+// Command-line client for casesar_scowl --serve.
+
+static void printUsage(const char *prog) {
+    cerr << "Usage: " << prog << " --socket PATH [--encrypt K | --decrypt K | --stats] [TEXT...]\n"
+         << "  Sends TEXT (arguments joined by spaces), or else every stdin line as its\n"
+         << "  own request, and prints one response body per line. Cracking is the\n"
+         << "  default; its responses are the --batch result columns.\n";
+}
+
+// Requests kept in flight when reading stdin.
+const size_t CLIENT_WINDOW = 64;
+
+int main(int argc, char **argv) {
+    string socketPath, text;
+    CrackOp op = CRACK_OP_CRACK;
+    int key = 0;
+    bool haveText = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--socket" && hasValue) socketPath = argv[++i];
+        else if ((arg == "--encrypt" || arg == "--decrypt") && hasValue) {
+            op = arg == "--encrypt" ? CRACK_OP_ENCRYPT : CRACK_OP_DECRYPT;
+            if (!parseShiftKey(argv[++i], key)) {
+                cerr << "Error: invalid key for " << arg << ": " << argv[i] << '\n';
+                printUsage(argv[0]);
+                return 2;
+            }
+        }
+        else if (arg == "--stats") op = CRACK_OP_STATS;
+        else if (arg.size() > 1 && arg[0] == '-' && arg[1] == '-') { printUsage(argv[0]); return 2; }
+        else {
+            if (haveText) text += ' ';
+            text += arg;
+            haveText = true;
+        }
+    }
+    if (socketPath.empty()) { printUsage(argv[0]); return 2; }
+
+    string err;
+    int fd = connectUnix(socketPath, err);
+    if (fd < 0) { cerr << "Error: " << err << '\n'; return 1; }
+
+    int rc = 0;
+    size_t inFlight = 0;
+    auto receiveOne = [&]() -> bool {
+        CrackStatus status;
+        string body;
+        if (!readResponse(fd, status, body)) { cerr << "Error: connection closed by server\n"; return false; }
+        --inFlight;
+        if (status != CRACK_STATUS_OK) { cout << "ERROR\n"; rc = 1; }
+        else cout << body << '\n';
+        return true;
+    };
+    auto sendOne = [&](const string &t) -> bool {
+        string frame;
+        appendRequestFrame(frame, op, key, t);
+        if (!sendAll(fd, frame.data(), frame.size())) { cerr << "Error: send failed\n"; return false; }
+        ++inFlight;
+        return true;
+    };
+
+    bool ok = true;
+    if (haveText || op == CRACK_OP_STATS) {
+        ok = sendOne(text) && receiveOne();
+    } else {
+        string line;
+        while (ok && getline(cin, line)) {
+            ok = sendOne(line);
+            if (ok && inFlight == CLIENT_WINDOW) ok = receiveOne();
+        }
+        while (ok && inFlight > 0) ok = receiveOne();
+    }
+    close(fd);
+    return ok ? rc : 1;
+}
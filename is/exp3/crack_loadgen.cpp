@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "caesar_kernel.hpp"
+#include "crack_protocol.hpp"
+using namespace std;
+
+// Load generator for casesar_scowl --serve: C connections, each keeping
+// up to D requests in flight, cycle through a message list. Latency is
+// measured per request from send to response.
+
+static void printUsage(const char *prog) {
+    cerr << "Usage: " << prog << " --socket PATH [--connections C] [--requests N] [--depth D]\n"
+         << "        [--in FILE] [--op crack|encrypt]\n"
+         << "  --connections C  concurrent connections (default 4)\n"
+         << "  --requests N     requests per connection (default 10000)\n"
+         << "  --depth D        requests pipelined per connection (default 1)\n"
+         << "  --in FILE        messages, one per line (default: built-in Caesar ciphertexts)\n"
+         << "  --op crack|encrypt  request type (default crack)\n";
+}
+
+// A few sentences under assorted keys.
+static vector<string> builtinMessages() {
+    const char *plain[] = {
+        "the quick brown fox jumps over the lazy dog",
+        "meet me at the usual place at ten and bring the documents",
+        "all that glitters is not gold",
+        "we attack at dawn unless the weather turns against us",
+        "it was the best of times it was the worst of times",
+        "there is nothing either good or bad but thinking makes it so",
+    };
+    vector<string> out;
+    int key = 3;
+    for (const char *p : plain) {
+        out.push_back(caesarShift(string(p), key));
+        key = (key + 7) % 26;
+    }
+    return out;
+}
+
+struct WorkerResult {
+    vector<uint64_t> latencyNs;
+    size_t errors = 0;
+    string failure;
+};
+
+static void runConnection(const string &socketPath, const vector<string> &messages, CrackOp op,
+                          size_t requests, size_t depth, size_t offset, WorkerResult &res) {
+    using Clock = chrono::steady_clock;
+    string err;
+    int fd = connectUnix(socketPath, err);
+    if (fd < 0) { res.failure = err; return; }
+    res.latencyNs.reserve(requests);
+
+    deque<Clock::time_point> sent;
+    string frame, body;
+    size_t next = 0;
+    while (res.latencyNs.size() + res.errors < requests) {
+        frame.clear();
+        while (next < requests && sent.size() < depth) {
+            appendRequestFrame(frame, op, 5, messages[(offset + next) % messages.size()]);
+            sent.push_back(Clock::now());
+            ++next;
+        }
+        if (!frame.empty() && !sendAll(fd, frame.data(), frame.size())) { res.failure = "send failed"; break; }
+        CrackStatus status;
+        if (!readResponse(fd, status, body)) { res.failure = "connection closed by server"; break; }
+        uint64_t ns = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(Clock::now() - sent.front()).count());
+        sent.pop_front();
+        if (status == CRACK_STATUS_OK) res.latencyNs.push_back(ns);
+        else ++res.errors;
+    }
+    close(fd);
+}
+
+int main(int argc, char **argv) {
+    string socketPath, inPath;
+    size_t connections = 4, requests = 10000, depth = 1;
+    CrackOp op = CRACK_OP_CRACK;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--socket" && hasValue) socketPath = argv[++i];
+        else if (arg == "--connections" && hasValue) connections = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--requests" && hasValue) requests = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--depth" && hasValue) depth = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--in" && hasValue) inPath = argv[++i];
+        else if (arg == "--op" && hasValue) {
+            string v = argv[++i];
+            if (v == "crack") op = CRACK_OP_CRACK;
+            else if (v == "encrypt") op = CRACK_OP_ENCRYPT;
+            else { printUsage(argv[0]); return 2; }
+        }
+        else { printUsage(argv[0]); return 2; }
+    }
+    if (socketPath.empty() || connections == 0 || requests == 0 || depth == 0) { printUsage(argv[0]); return 2; }
+
+    vector<string> messages;
+    if (!inPath.empty()) {
+        ifstream in(inPath);
+        if (!in) { cerr << "Error: cannot open " << inPath << '\n'; return 1; }
+        for (string line; getline(in, line);) {
+            if (!line.empty()) messages.push_back(line);
+        }
+    } else {
+        messages = builtinMessages();
+    }
+    if (messages.empty()) { cerr << "Error: no messages\n"; return 1; }
+
+    vector<WorkerResult> results(connections);
+    vector<thread> threads;
+    auto start = chrono::steady_clock::now();
+    for (size_t c = 0; c < connections; ++c) {
+        threads.emplace_back([&, c] {
+            runConnection(socketPath, messages, op, requests, depth, c * 7919, results[c]);
+        });
+    }
+    for (auto &t : threads) t.join();
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    vector<uint64_t> all;
+    size_t errors = 0;
+    for (const WorkerResult &r : results) {
+        if (!r.failure.empty()) cerr << "Connection failed: " << r.failure << '\n';
+        all.insert(all.end(), r.latencyNs.begin(), r.latencyNs.end());
+        errors += r.errors;
+    }
+    if (all.empty()) { cerr << "Error: no successful requests\n"; return 1; }
+    sort(all.begin(), all.end());
+    auto quantileUs = [&](double q) { return all[static_cast<size_t>(q * (all.size() - 1))] / 1e3; };
+    printf("%zu requests (%zu errors) over %zu connections, depth %zu, in %.3f s: %.0f req/s\n",
+           all.size(), errors, connections, depth, secs, all.size() / secs);
+    printf("latency us: p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+           quantileUs(0.50), quantileUs(0.90), quantileUs(0.99), quantileUs(0.999), all.back() / 1e3);
+
+    // The server's own view (queueing + work, without the socket round trip).
+    string err, frame, body;
+    int fd = connectUnix(socketPath, err);
+    CrackStatus status;
+    appendRequestFrame(frame, CRACK_OP_STATS, 0, "");
+    if (fd >= 0 && sendAll(fd, frame.data(), frame.size()) && readResponse(fd, status, body))
+        printf("server: %s\n", body.c_str());
+    if (fd >= 0) close(fd);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,170 @@
+#pragma once
+// Wire format of the casesar_scowl --serve daemon (Unix domain socket).
+// Every message is a frame: 4-byte big-endian payload length, then the
+// payload.
+//   request:  op (1 byte) | key (4 bytes, big-endian, signed) | text
+//   response: status (1 byte) | body
+// Ops: 'C' crack text (key ignored); body is the --batch result columns
+//      key \t matches \t totalWords \t ratio \t commonHits \t chi2 \t plaintext
+//      'E' / 'D' encrypt / decrypt text with key; body is the result
+//      'S' server statistics as JSON (key and text ignored)
+// A connection may pipeline requests; responses come back in order.
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+enum CrackOp : uint8_t {
+    CRACK_OP_CRACK = 'C',
+    CRACK_OP_ENCRYPT = 'E',
+    CRACK_OP_DECRYPT = 'D',
+    CRACK_OP_STATS = 'S',
+};
+
+enum CrackStatus : uint8_t {
+    CRACK_STATUS_OK = 0,
+    CRACK_STATUS_BAD_REQUEST = 1,
+};
+
+// Larger frames are a protocol error; the server drops the connection.
+constexpr uint32_t CRACK_MAX_FRAME = 64u << 20;
+constexpr size_t CRACK_REQUEST_HEADER = 5;
+
+struct CrackRequest {
+    CrackOp op = CRACK_OP_CRACK;
+    int32_t key = 0;
+    std::string_view text;
+};
+
+inline void appendU32(std::string &out, uint32_t v) {
+    char b[4] = {static_cast<char>(v >> 24), static_cast<char>(v >> 16), static_cast<char>(v >> 8), static_cast<char>(v)};
+    out.append(b, 4);
+}
+
+inline uint32_t readU32(const char *p) {
+    const unsigned char *u = reinterpret_cast<const unsigned char *>(p);
+    return (uint32_t(u[0]) << 24) | (uint32_t(u[1]) << 16) | (uint32_t(u[2]) << 8) | uint32_t(u[3]);
+}
+
+inline void appendRequestFrame(std::string &out, CrackOp op, int32_t key, std::string_view text) {
+    appendU32(out, static_cast<uint32_t>(CRACK_REQUEST_HEADER + text.size()));
+    out.push_back(static_cast<char>(op));
+    appendU32(out, static_cast<uint32_t>(key));
+    out.append(text.data(), text.size());
+}
+
+inline void appendResponseFrame(std::string &out, CrackStatus status, std::string_view body) {
+    appendU32(out, static_cast<uint32_t>(1 + body.size()));
+    out.push_back(static_cast<char>(status));
+    out.append(body.data(), body.size());
+}
+
+// Result of looking for a frame at buf[pos...].
+enum class FrameParse { Complete, NeedMore, TooLarge };
+
+// On Complete, payload views into buf and pos moves past the frame.
+inline FrameParse nextFrame(std::string_view buf, size_t &pos, std::string_view &payload) {
+    if (buf.size() - pos < 4) return FrameParse::NeedMore;
+    uint32_t len = readU32(buf.data() + pos);
+    if (len > CRACK_MAX_FRAME) return FrameParse::TooLarge;
+    if (buf.size() - pos - 4 < len) return FrameParse::NeedMore;
+    payload = buf.substr(pos + 4, len);
+    pos += 4 + len;
+    return FrameParse::Complete;
+}
+
+inline bool parseRequest(std::string_view payload, CrackRequest &req) {
+    if (payload.size() < CRACK_REQUEST_HEADER) return false;
+    req.op = static_cast<CrackOp>(payload[0]);
+    req.key = static_cast<int32_t>(readU32(payload.data() + 1));
+    req.text = payload.substr(CRACK_REQUEST_HEADER);
+    return true;
+}
+
+#ifndef _WIN32
+
+inline bool fillSocketAddress(const std::string &path, sockaddr_un &addr, std::string &err) {
+    std::memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof addr.sun_path) {
+        err = "socket path must be 1.." + std::to_string(sizeof addr.sun_path - 1) + " bytes";
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+// Bound, listening socket at path; a stale socket file there is replaced.
+inline int listenUnix(const std::string &path, std::string &err) {
+    sockaddr_un addr;
+    if (!fillSocketAddress(path, addr, err)) return -1;
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0 || listen(fd, 128) != 0) {
+        err = path + ": " + std::strerror(errno);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+inline int connectUnix(const std::string &path, std::string &err) {
+    sockaddr_un addr;
+    if (!fillSocketAddress(path, addr, err)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0) {
+        err = path + ": " + std::strerror(errno);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Blocking helpers for the client side.
+inline bool sendAll(int fd, const char *p, size_t n) {
+    while (n > 0) {
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+inline bool recvAll(int fd, char *p, size_t n) {
+    while (n > 0) {
+        ssize_t r = recv(fd, p, n, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        p += r;
+        n -= static_cast<size_t>(r);
+    }
+    return true;
+}
+
+// Next response frame from fd.
+inline bool readResponse(int fd, CrackStatus &status, std::string &body) {
+    char len[4];
+    if (!recvAll(fd, len, 4)) return false;
+    uint32_t n = readU32(len);
+    if (n == 0 || n > CRACK_MAX_FRAME) return false;
+    char st;
+    if (!recvAll(fd, &st, 1)) return false;
+    status = static_cast<CrackStatus>(st);
+    body.resize(n - 1);
+    return n == 1 || recvAll(fd, &body[0], n - 1);
+}
+
+#endif // _WIN32
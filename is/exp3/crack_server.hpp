@@ -0,0 +1,311 @@
+#pragma once
+// Event loop behind casesar_scowl --serve.
+// One thread polls the listening socket and every connection. All frames
+// that arrived since the last round form a batch, which is spread over a
+// WorkStealingPool; while the pool works, new requests pile up in the
+// socket buffers and make up the next batch. Responses are queued per
+// connection in request order and written as the sockets drain; a client
+// that sends without reading is not read from again until its queue drops
+// below CRACK_MAX_PENDING_OUTPUT.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "crack_protocol.hpp"
+#include "work_pool.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
+// Log-linear latency histogram: 8 sub-buckets per power of two of
+// nanoseconds, so a quantile is within 12.5% of the true value.
+class LatencyHistogram {
+public:
+    static constexpr int SUB = 8;
+    static constexpr int BUCKETS = 64 * SUB;
+
+    void add(uint64_t ns) {
+        ++buckets_[index(ns)];
+        ++count_;
+        maxNs_ = std::max(maxNs_, ns);
+    }
+
+    void merge(const LatencyHistogram &o) {
+        for (int i = 0; i < BUCKETS; ++i) buckets_[i] += o.buckets_[i];
+        count_ += o.count_;
+        maxNs_ = std::max(maxNs_, o.maxNs_);
+    }
+
+    void clear() { *this = LatencyHistogram(); }
+
+    uint64_t count() const { return count_; }
+    uint64_t maxNs() const { return maxNs_; }
+
+    // Upper bound of the bucket holding quantile q (0..1).
+    uint64_t quantileNs(double q) const {
+        if (count_ == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(count_ - 1)) + 1, seen = 0;
+        for (int i = 0; i < BUCKETS; ++i) {
+            seen += buckets_[i];
+            if (seen >= rank) return std::min(upperBound(i), maxNs_);
+        }
+        return maxNs_;
+    }
+
+private:
+    static int index(uint64_t ns) {
+        if (ns < SUB) return static_cast<int>(ns);
+        int log = 63 - __builtin_clzll(ns);          // >= 3
+        int sub = static_cast<int>((ns >> (log - 3)) & (SUB - 1));
+        return (log - 2) * SUB + sub;
+    }
+    static uint64_t upperBound(int i) {
+        if (i < SUB) return static_cast<uint64_t>(i);
+        int log = i / SUB + 2, sub = i % SUB;
+        return ((static_cast<uint64_t>(SUB + sub + 1)) << (log - 3)) - 1;
+    }
+
+    uint64_t buckets_[BUCKETS] = {};
+    uint64_t count_ = 0;
+    uint64_t maxNs_ = 0;
+};
+
+// Queued response bytes past which a connection's requests are left in
+// its socket (the client has to read before it can send more).
+constexpr size_t CRACK_MAX_PENDING_OUTPUT = 4u << 20;
+// How long accepting pauses after accept fails for a reason other than an
+// empty queue (EMFILE, ENFILE, ENOBUFS...), which would leave the listening
+// socket readable and spin poll.
+constexpr std::chrono::milliseconds CRACK_ACCEPT_BACKOFF{100};
+
+struct CrackServerOptions {
+    std::string socketPath;
+    unsigned threads = 0;       // 0 = all cores
+    double reportSeconds = 10;  // latency line on the log every this often; 0 = never
+};
+
+// Fills the response body for one crack/encrypt/decrypt request and
+// returns false for a request it cannot serve. Called on pool threads.
+using CrackHandler = std::function<bool(const CrackRequest &req, std::string &body)>;
+
+inline std::atomic<bool> &crackServerStopFlag() {
+    static std::atomic<bool> stop{false};
+    return stop;
+}
+
+#ifndef _WIN32
+
+namespace crack_server_detail {
+
+struct Connection {
+    int fd = -1;
+    std::string in;
+    size_t inPos = 0;   // first unparsed byte of in
+    std::string out;
+    size_t outPos = 0;  // first unsent byte of out
+    bool closing = false;
+
+    size_t pending() const { return out.size() - outPos; }
+};
+
+struct Job {
+    size_t conn;
+    std::string payload;
+    std::chrono::steady_clock::time_point received;
+    bool ok = false;
+    std::string body;
+};
+
+inline void onStopSignal(int) { crackServerStopFlag().store(true); }
+
+inline std::string latencyLine(const LatencyHistogram &h, double secs) {
+    char buf[200];
+    snprintf(buf, sizeof buf, "%llu requests in %.1f s (%.0f req/s), p50 %.1f us, p99 %.1f us, max %.1f us",
+             static_cast<unsigned long long>(h.count()), secs, secs > 0 ? h.count() / secs : 0.0,
+             h.quantileNs(0.50) / 1e3, h.quantileNs(0.99) / 1e3, h.maxNs() / 1e3);
+    return buf;
+}
+
+inline std::string statsJson(const LatencyHistogram &h, double secs, size_t connections, unsigned threads) {
+    char buf[400];
+    snprintf(buf, sizeof buf,
+             "{\"uptimeSeconds\": %.3f, \"requests\": %llu, \"connections\": %zu, \"threads\": %u, "
+             "\"p50Us\": %.3f, \"p90Us\": %.3f, \"p99Us\": %.3f, \"maxUs\": %.3f}",
+             secs, static_cast<unsigned long long>(h.count()), connections, threads,
+             h.quantileNs(0.50) / 1e3, h.quantileNs(0.90) / 1e3, h.quantileNs(0.99) / 1e3, h.maxNs() / 1e3);
+    return buf;
+}
+
+} // namespace crack_server_detail
+
+// Serve until SIGINT/SIGTERM (or crackServerStopFlag()). Returns the exit code.
+inline int runCrackServer(const CrackServerOptions &opts, const CrackHandler &handler, std::ostream &log) {
+    using namespace crack_server_detail;
+    using Clock = std::chrono::steady_clock;
+
+    std::string err;
+    int listenFd = listenUnix(opts.socketPath, err);
+    if (listenFd < 0) {
+        log << "Error: " << err << '\n';
+        return 1;
+    }
+    fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+    crackServerStopFlag().store(false);
+    std::signal(SIGINT, onStopSignal);
+    std::signal(SIGTERM, onStopSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    WorkStealingPool pool(opts.threads);
+    log << "Listening on " << opts.socketPath << " with " << pool.size() << " worker threads.\n";
+
+    std::vector<std::unique_ptr<Connection>> conns;
+    std::vector<pollfd> fds;
+    std::vector<Job> jobs;
+    LatencyHistogram total, interval;
+    Clock::time_point start = Clock::now(), lastReport = start;
+    Clock::time_point acceptResume = start;
+    bool acceptFailing = false;
+    std::vector<char> readBuf(1 << 16);
+
+    while (!crackServerStopFlag().load()) {
+        fds.assign(1, pollfd{listenFd, static_cast<short>(Clock::now() < acceptResume ? 0 : POLLIN), 0});
+        for (const auto &c : conns) {
+            short events = c->closing || c->pending() >= CRACK_MAX_PENDING_OUTPUT ? 0 : POLLIN;
+            if (c->pending() > 0) events |= POLLOUT;
+            fds.push_back(pollfd{c->fd, events, 0});
+        }
+        int ready = poll(fds.data(), fds.size(), 200);
+        if (ready < 0 && errno != EINTR) {
+            log << "Error: poll: " << std::strerror(errno) << '\n';
+            break;
+        }
+
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            for (;;) {
+                int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd >= 0) {
+                    conns.push_back(std::make_unique<Connection>());
+                    conns.back()->fd = fd;
+                    acceptFailing = false;
+                    continue;
+                }
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    // Logged once per run of failures; retried after the back-off.
+                    if (!acceptFailing) log << "Error: accept: " << std::strerror(errno) << " (backing off)\n";
+                    acceptFailing = true;
+                    acceptResume = Clock::now() + CRACK_ACCEPT_BACKOFF;
+                }
+                break;
+            }
+        }
+
+        // Read whatever arrived and cut it into jobs.
+        for (size_t i = 0; ready > 0 && i + 1 < fds.size(); ++i) {
+            Connection &c = *conns[i];
+            if (!(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            if (c.pending() >= CRACK_MAX_PENDING_OUTPUT) continue; // leave it to the flush below
+            // At most CRACK_MAX_PENDING_OUTPUT bytes a round, so one round's
+            // responses stay bounded too.
+            for (size_t budget = CRACK_MAX_PENDING_OUTPUT;;) {
+                ssize_t r = recv(c.fd, readBuf.data(), std::min(readBuf.size(), budget), 0);
+                if (r > 0) {
+                    c.in.append(readBuf.data(), static_cast<size_t>(r));
+                    budget -= static_cast<size_t>(r);
+                    if (budget == 0) break;
+                    continue;
+                }
+                if (r < 0 && errno == EINTR) continue;
+                if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) c.closing = true;
+                break;
+            }
+            Clock::time_point now = Clock::now();
+            std::string_view payload;
+            for (;;) {
+                FrameParse st = nextFrame(c.in, c.inPos, payload);
+                if (st == FrameParse::NeedMore) break;
+                if (st == FrameParse::TooLarge) { c.closing = true; break; }
+                jobs.push_back(Job{i, std::string(payload), now, false, std::string()});
+            }
+            c.in.erase(0, c.inPos);
+            c.inPos = 0;
+        }
+
+        if (!jobs.empty()) {
+            double uptime = std::chrono::duration<double>(Clock::now() - start).count();
+            pool.parallelFor(jobs.size(), std::max<size_t>(1, jobs.size() / (4 * pool.size())), [&](size_t b, size_t e) {
+                for (size_t j = b; j < e; ++j) {
+                    Job &job = jobs[j];
+                    CrackRequest req;
+                    if (!parseRequest(job.payload, req)) continue;
+                    if (req.op == CRACK_OP_STATS) {
+                        job.body = statsJson(total, uptime, conns.size(), pool.size());
+                        job.ok = true;
+                    } else {
+                        job.ok = handler(req, job.body);
+                    }
+                }
+            });
+            Clock::time_point done = Clock::now();
+            for (Job &job : jobs) {
+                Connection &c = *conns[job.conn];
+                appendResponseFrame(c.out, job.ok ? CRACK_STATUS_OK : CRACK_STATUS_BAD_REQUEST, job.body);
+                uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(done - job.received).count());
+                total.add(ns);
+                interval.add(ns);
+            }
+            jobs.clear();
+        }
+
+        // Flush, then drop connections that are finished.
+        for (auto &cp : conns) {
+            Connection &c = *cp;
+            while (c.outPos < c.out.size()) {
+                ssize_t w = send(c.fd, c.out.data() + c.outPos, c.out.size() - c.outPos, MSG_NOSIGNAL);
+                if (w > 0) { c.outPos += static_cast<size_t>(w); continue; }
+                if (w < 0 && errno == EINTR) continue;
+                if (w < 0 && errno != EAGAIN && errno != EWOULDBLOCK) { c.closing = true; c.out.clear(); c.outPos = 0; }
+                break;
+            }
+            if (c.outPos == c.out.size()) {
+                c.out.clear();
+                c.outPos = 0;
+            } else if (c.outPos >= c.out.size() / 2) {
+                c.out.erase(0, c.outPos); // a slow reader must not make out grow with what it already took
+                c.outPos = 0;
+            }
+        }
+        conns.erase(std::remove_if(conns.begin(), conns.end(), [](const std::unique_ptr<Connection> &c) {
+            if (!c->closing || !c->out.empty()) return false;
+            close(c->fd);
+            return true;
+        }), conns.end());
+
+        Clock::time_point now = Clock::now();
+        double sinceReport = std::chrono::duration<double>(now - lastReport).count();
+        if (opts.reportSeconds > 0 && sinceReport >= opts.reportSeconds) {
+            if (interval.count() > 0) log << latencyLine(interval, sinceReport) << '\n';
+            interval.clear();
+            lastReport = now;
+        }
+    }
+
+    for (auto &c : conns) close(c->fd);
+    close(listenFd);
+    unlink(opts.socketPath.c_str());
+    log << "Shutting down: " << latencyLine(total, std::chrono::duration<double>(Clock::now() - start).count()) << '\n';
+    return 0;
+}
+
+#endif // _WIN32
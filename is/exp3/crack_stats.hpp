@@ -0,0 +1,238 @@
+#pragma once
+// Hot-path instrumentation for the Caesar cracker.
+// Build with -DCAESAR_STATS to collect; otherwise every CRACK_STAT_* macro
+// expands to nothing and the cracker compiles exactly as before.
+//
+// Each thread writes to its own block (no atomics or shared cache lines on
+// the hot path); crackStatsJson() sums all blocks, so read it only once the
+// worker threads are idle. Allocations are counted from the moment a thread
+// has a block, so main and every worker create theirs up front with
+// CRACK_STAT_THREAD_START().
+
+#include <cstdint>
+
+#ifdef CAESAR_STATS
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum class StatStage { LoadDict, Decrypt, Tokenize, DictProbe, ChiSquare, VoteTally, NgramScore, Count };
+enum class StatCounter { Messages, CipherBytes, DecryptedBytes, WordsTokenized, DictHits, DictMisses, Allocations,
+                         DictEscalations, Count };
+
+inline const char *statStageName(StatStage s) {
+    static const char *names[] = {"loadDictFile", "decryptWithKey", "splitWordsLower", "dictProbe",
+                                  "chiSquare", "voteTally", "ngramScore"};
+    return names[static_cast<int>(s)];
+}
+
+inline const char *statCounterName(StatCounter c) {
+    static const char *names[] = {"messages", "cipherBytes", "decryptedBytes", "wordsTokenized",
+                                  "dictHits", "dictMisses", "allocations", "dictEscalations"};
+    return names[static_cast<int>(c)];
+}
+
+// Log2 latency buckets: bucket b holds durations in [2^(b-1), 2^b) ns.
+const int STAT_LATENCY_BUCKETS = 40;
+
+struct CrackStatsBlock {
+    uint64_t stageNs[static_cast<int>(StatStage::Count)] = {};
+    uint64_t stageCalls[static_cast<int>(StatStage::Count)] = {};
+    uint64_t counters[static_cast<int>(StatCounter::Count)] = {};
+    uint64_t keyNs[26] = {};
+    uint64_t keyCalls[26] = {};
+    uint64_t latency[STAT_LATENCY_BUCKETS] = {};
+    uint64_t latencyMaxNs = 0;
+};
+
+struct CrackStatsRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<CrackStatsBlock>> blocks;
+};
+
+inline CrackStatsRegistry &crackStatsRegistry() {
+    static CrackStatsRegistry *r = new CrackStatsRegistry; // outlives exiting threads
+    return *r;
+}
+
+// Constant-initialized, so it is safe to read from inside operator new.
+inline CrackStatsBlock *&crackStatsTls() {
+    static thread_local CrackStatsBlock *block = nullptr;
+    return block;
+}
+
+inline CrackStatsBlock &crackStatsLocal() {
+    CrackStatsBlock *&block = crackStatsTls();
+    if (!block) {
+        CrackStatsRegistry &r = crackStatsRegistry();
+        std::lock_guard<std::mutex> lk(r.mutex);
+        r.blocks.push_back(std::make_unique<CrackStatsBlock>());
+        block = r.blocks.back().get();
+    }
+    return *block;
+}
+
+// For a replacement operator new: never allocates, and skips threads
+// without a block (see CRACK_STAT_THREAD_START).
+inline void statCountAllocation() {
+    if (CrackStatsBlock *b = crackStatsTls()) b->counters[static_cast<int>(StatCounter::Allocations)]++;
+}
+
+inline uint64_t statNowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+inline void statAdd(StatCounter c, uint64_t n) { crackStatsLocal().counters[static_cast<int>(c)] += n; }
+
+inline void statLatency(uint64_t ns) {
+    CrackStatsBlock &b = crackStatsLocal();
+    int bucket = ns ? 64 - __builtin_clzll(ns) : 0;
+    if (bucket >= STAT_LATENCY_BUCKETS) bucket = STAT_LATENCY_BUCKETS - 1;
+    b.latency[bucket]++;
+    if (ns > b.latencyMaxNs) b.latencyMaxNs = ns;
+}
+
+class StatStageScope {
+public:
+    explicit StatStageScope(StatStage s) : stage_(static_cast<int>(s)), start_(statNowNs()) {}
+    ~StatStageScope() {
+        CrackStatsBlock &b = crackStatsLocal();
+        b.stageNs[stage_] += statNowNs() - start_;
+        b.stageCalls[stage_]++;
+    }
+
+private:
+    int stage_;
+    uint64_t start_;
+};
+
+class StatKeyScope {
+public:
+    explicit StatKeyScope(int key) : key_(key), start_(statNowNs()) {}
+    ~StatKeyScope() {
+        CrackStatsBlock &b = crackStatsLocal();
+        b.keyNs[key_] += statNowNs() - start_;
+        b.keyCalls[key_]++;
+    }
+
+private:
+    int key_;
+    uint64_t start_;
+};
+
+class StatLatencyScope {
+public:
+    StatLatencyScope() : start_(statNowNs()) {}
+    ~StatLatencyScope() { statLatency(statNowNs() - start_); }
+
+private:
+    uint64_t start_;
+};
+
+// Sum of every thread's block.
+inline CrackStatsBlock crackStatsTotal() {
+    CrackStatsBlock t;
+    CrackStatsRegistry &r = crackStatsRegistry();
+    std::lock_guard<std::mutex> lk(r.mutex);
+    for (const auto &b : r.blocks) {
+        for (int i = 0; i < static_cast<int>(StatStage::Count); ++i) {
+            t.stageNs[i] += b->stageNs[i];
+            t.stageCalls[i] += b->stageCalls[i];
+        }
+        for (int i = 0; i < static_cast<int>(StatCounter::Count); ++i) t.counters[i] += b->counters[i];
+        for (int k = 0; k < 26; ++k) {
+            t.keyNs[k] += b->keyNs[k];
+            t.keyCalls[k] += b->keyCalls[k];
+        }
+        for (int i = 0; i < STAT_LATENCY_BUCKETS; ++i) t.latency[i] += b->latency[i];
+        if (b->latencyMaxNs > t.latencyMaxNs) t.latencyMaxNs = b->latencyMaxNs;
+    }
+    return t;
+}
+
+// Upper bound (ns) of the bucket holding quantile q of the latencies.
+inline uint64_t statLatencyQuantile(const CrackStatsBlock &t, double q) {
+    uint64_t total = 0;
+    for (uint64_t c : t.latency) total += c;
+    if (total == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1, seen = 0;
+    for (int b = 0; b < STAT_LATENCY_BUCKETS; ++b) {
+        seen += t.latency[b];
+        if (seen >= rank) return b ? (1ull << b) : 1;
+    }
+    return t.latencyMaxNs;
+}
+
+inline std::string crackStatsJson() {
+    CrackStatsBlock t = crackStatsTotal();
+    std::string s = "{\n  \"stages\": {";
+    char buf[160];
+    for (int i = 0; i < static_cast<int>(StatStage::Count); ++i) {
+        snprintf(buf, sizeof buf, "%s\n    \"%s\": {\"calls\": %llu, \"ns\": %llu}", i ? "," : "",
+                 statStageName(static_cast<StatStage>(i)), static_cast<unsigned long long>(t.stageCalls[i]),
+                 static_cast<unsigned long long>(t.stageNs[i]));
+        s += buf;
+    }
+    s += "\n  },\n  \"counters\": {";
+    for (int i = 0; i < static_cast<int>(StatCounter::Count); ++i) {
+        snprintf(buf, sizeof buf, "%s\n    \"%s\": %llu", i ? "," : "", statCounterName(static_cast<StatCounter>(i)),
+                 static_cast<unsigned long long>(t.counters[i]));
+        s += buf;
+    }
+    s += "\n  },\n  \"perKey\": [";
+    for (int k = 0; k < 26; ++k) {
+        snprintf(buf, sizeof buf, "%s\n    {\"key\": %d, \"calls\": %llu, \"ns\": %llu}", k ? "," : "", k,
+                 static_cast<unsigned long long>(t.keyCalls[k]), static_cast<unsigned long long>(t.keyNs[k]));
+        s += buf;
+    }
+    s += "\n  ]";
+    uint64_t messages = 0;
+    for (uint64_t c : t.latency) messages += c;
+    if (messages) {
+        snprintf(buf, sizeof buf,
+                 ",\n  \"latency\": {\"messages\": %llu, \"p50Ns\": %llu, \"p90Ns\": %llu, \"p99Ns\": %llu, "
+                 "\"maxNs\": %llu, \"buckets\": [",
+                 static_cast<unsigned long long>(messages),
+                 static_cast<unsigned long long>(statLatencyQuantile(t, 0.50)),
+                 static_cast<unsigned long long>(statLatencyQuantile(t, 0.90)),
+                 static_cast<unsigned long long>(statLatencyQuantile(t, 0.99)),
+                 static_cast<unsigned long long>(t.latencyMaxNs));
+        s += buf;
+        bool first = true;
+        for (int b = 0; b < STAT_LATENCY_BUCKETS; ++b) {
+            if (!t.latency[b]) continue;
+            snprintf(buf, sizeof buf, "%s\n    {\"ltNs\": %llu, \"count\": %llu}", first ? "" : ",",
+                     static_cast<unsigned long long>(b ? (1ull << b) : 1), static_cast<unsigned long long>(t.latency[b]));
+            s += buf;
+            first = false;
+        }
+        s += "\n  ]}";
+    }
+    s += "\n}\n";
+    return s;
+}
+
+#define CRACK_STAT_CONCAT_(a, b) a##b
+#define CRACK_STAT_CONCAT(a, b) CRACK_STAT_CONCAT_(a, b)
+#define CRACK_STAT_SCOPE(stage) StatStageScope CRACK_STAT_CONCAT(crackStatScope_, __LINE__)(StatStage::stage)
+#define CRACK_STAT_KEY_SCOPE(key) StatKeyScope CRACK_STAT_CONCAT(crackStatKey_, __LINE__)(key)
+#define CRACK_STAT_LATENCY_SCOPE() StatLatencyScope CRACK_STAT_CONCAT(crackStatLatency_, __LINE__)
+#define CRACK_STAT_ADD(counter, n) statAdd(StatCounter::counter, static_cast<uint64_t>(n))
+#define CRACK_STAT_THREAD_START() ((void)crackStatsLocal())
+const bool CRACK_STATS_ENABLED = true;
+
+#else
+
+#define CRACK_STAT_SCOPE(stage) ((void)0)
+#define CRACK_STAT_KEY_SCOPE(key) ((void)0)
+#define CRACK_STAT_LATENCY_SCOPE() ((void)0)
+#define CRACK_STAT_ADD(counter, n) ((void)0)
+#define CRACK_STAT_THREAD_START() ((void)0)
+const bool CRACK_STATS_ENABLED = false;
+
+#endif // CAESAR_STATS
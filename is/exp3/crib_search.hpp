@@ -0,0 +1,188 @@
+#pragma once
+// Crib search: find known plaintext words or phrases in Caesar ciphertext
+// without knowing the key. Every crib is enciphered under all 26 shifts and
+// the 26 x N patterns go into one Aho-Corasick automaton, so a single pass
+// over the ciphertext finds every crib under every key.
+//
+// Bytes are reduced to 27 classes (letters case-folded, and one class for
+// everything else), so a non-letter in a crib matches any one non-letter
+// byte: " the " only matches the whole word. The automaton is a dense DFA:
+// one row of 32 uint32 entries (128 bytes) per state, failure links folded
+// in, each entry holding the next row's offset with bit 0 flagging states
+// that end a pattern. A step is one table load plus a mask.
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "caesar_kernel.hpp"
+#include "work_pool.hpp"
+
+// crib (an index into the cribs) found at byte offset of the ciphertext
+// with encryption shift key.
+struct CribMatch {
+    uint64_t offset;
+    uint32_t crib;
+    int key;
+};
+
+class CribAutomaton {
+public:
+    static constexpr uint32_t CLASSES = 27;
+    static constexpr uint32_t ROW = 32;   // entries per state (CLASSES padded)
+    static constexpr uint32_t ROOT = 0;   // row offset of the start state
+
+    // Cribs without any letter are ignored (every shift would be the same).
+    explicit CribAutomaton(const std::vector<std::string> &cribs) : cribs_(cribs) {
+        const auto &idx = letterIndexTable();
+        newState();
+        std::vector<std::vector<uint32_t>> out(1);
+        std::vector<uint8_t> pattern;
+        for (uint32_t c = 0; c < cribs_.size(); ++c) {
+            pattern.clear();
+            bool letters = false;
+            for (unsigned char ch : cribs_[c]) {
+                pattern.push_back(idx[ch]);
+                letters |= idx[ch] < 26;
+            }
+            if (!letters) continue;
+            maxLength_ = std::max(maxLength_, pattern.size());
+            for (int key = 0; key < 26; ++key) {
+                uint32_t s = 0;
+                for (uint8_t cls : pattern) {
+                    if (cls < 26) cls = static_cast<uint8_t>((cls + key) % 26);
+                    size_t at = s * ROW + cls;
+                    if (delta_[at] == NONE) {
+                        uint32_t fresh = newState(); // grows delta_, so index again below
+                        delta_[at] = fresh;
+                        out.emplace_back();
+                    }
+                    s = delta_[at];
+                }
+                out[s].push_back(static_cast<uint32_t>(patterns_.size()));
+                patterns_.push_back(Pattern{c, key, static_cast<uint32_t>(pattern.size())});
+            }
+        }
+
+        // Breadth-first: failure links, missing edges filled from the
+        // failure state's row, outputs inherited along failure links.
+        std::vector<uint32_t> fail(states_, 0);
+        std::deque<uint32_t> queue;
+        for (uint32_t cls = 0; cls < CLASSES; ++cls) {
+            uint32_t &next = delta_[cls];
+            if (next == NONE) next = 0;
+            else queue.push_back(next);
+        }
+        while (!queue.empty()) {
+            uint32_t s = queue.front();
+            queue.pop_front();
+            const std::vector<uint32_t> &inherited = out[fail[s]];
+            out[s].insert(out[s].end(), inherited.begin(), inherited.end());
+            for (uint32_t cls = 0; cls < CLASSES; ++cls) {
+                uint32_t &next = delta_[s * ROW + cls];
+                uint32_t viaFail = delta_[fail[s] * ROW + cls];
+                if (next == NONE) {
+                    next = viaFail;
+                } else {
+                    fail[next] = viaFail;
+                    queue.push_back(next);
+                }
+            }
+        }
+
+        // Flatten the outputs, then store row offsets with the output flag.
+        outStart_.assign(states_ + 1, 0);
+        for (uint32_t s = 0; s < states_; ++s) {
+            outStart_[s + 1] = outStart_[s] + static_cast<uint32_t>(out[s].size());
+            outList_.insert(outList_.end(), out[s].begin(), out[s].end());
+        }
+        for (uint32_t &next : delta_) {
+            if (next == NONE) next = 0; // padding columns, never read
+            next = next * ROW | (out[next].empty() ? 0u : 1u);
+        }
+    }
+
+    const std::vector<std::string> &cribs() const { return cribs_; }
+    size_t states() const { return states_; }
+    size_t patterns() const { return patterns_.size(); }
+    size_t tableBytes() const { return delta_.size() * sizeof(uint32_t); }
+    // Longest crib; matches never span more bytes than this.
+    size_t maxLength() const { return maxLength_; }
+
+    // Feed p[0, n), which starts at ciphertext offset base, from state row;
+    // onMatch(const CribMatch &) for every match ending in it, in order of
+    // the end offset. Returns the state to resume from on the next block.
+    template <class F>
+    uint32_t scan(const char *p, size_t n, uint32_t row, uint64_t base, F &&onMatch) const {
+        const auto &idx = letterIndexTable();
+        const uint32_t *delta = delta_.data();
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t e = delta[row + idx[static_cast<unsigned char>(p[i])]];
+            row = e & ~1u;
+            if (e & 1u) report(row / ROW, base + i, onMatch);
+        }
+        return row;
+    }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Pattern {
+        uint32_t crib;
+        int key;
+        uint32_t length;
+    };
+
+    uint32_t newState() {
+        delta_.resize(delta_.size() + ROW, NONE);
+        return states_++;
+    }
+
+    template <class F>
+    void report(uint32_t state, uint64_t end, F &onMatch) const {
+        for (uint32_t i = outStart_[state]; i < outStart_[state + 1]; ++i) {
+            const Pattern &pt = patterns_[outList_[i]];
+            onMatch(CribMatch{end + 1 - pt.length, pt.crib, pt.key});
+        }
+    }
+
+    std::vector<std::string> cribs_;
+    std::vector<uint32_t> delta_;
+    std::vector<Pattern> patterns_;
+    std::vector<uint32_t> outStart_, outList_;
+    uint32_t states_ = 0;
+    size_t maxLength_ = 0;
+};
+
+// Bytes per parallel range. Each range also rescans the maxLength()-1
+// bytes before it, so matches straddling a boundary are found exactly once
+// (by the range their last byte falls in).
+const size_t CRIB_SEARCH_RANGE = 4 << 20;
+
+// Matches ending in data[begin, end), in the order scan() gives them; the
+// bytes before begin are only read to rebuild the automaton state. With a
+// pool, ranges of CRIB_SEARCH_RANGE bytes are searched in parallel.
+inline std::vector<CribMatch> findCribs(const CribAutomaton &ac, const char *data, size_t begin, size_t end,
+                                        WorkStealingPool *pool = nullptr) {
+    const size_t overlap = ac.maxLength() > 0 ? ac.maxLength() - 1 : 0;
+    const size_t ranges = end > begin ? (end - begin + CRIB_SEARCH_RANGE - 1) / CRIB_SEARCH_RANGE : 0;
+    std::vector<std::vector<CribMatch>> found(ranges);
+    auto search = [&](size_t b, size_t e) {
+        for (size_t r = b; r < e; ++r) {
+            size_t from = begin + r * CRIB_SEARCH_RANGE, to = std::min(end, from + CRIB_SEARCH_RANGE);
+            size_t warm = std::min(from, overlap);
+            // Matches ending in the warm-up bytes belong to the previous range.
+            uint32_t row = ac.scan(data + from - warm, warm, CribAutomaton::ROOT, 0, [](const CribMatch &) {});
+            std::vector<CribMatch> &dst = found[r];
+            ac.scan(data + from, to - from, row, from, [&dst](const CribMatch &m) { dst.push_back(m); });
+        }
+    };
+    if (pool && ranges > 1) pool->parallelFor(ranges, 1, search);
+    else search(0, ranges);
+    if (ranges == 1) return std::move(found[0]);
+    std::vector<CribMatch> matches;
+    for (const auto &f : found) matches.insert(matches.end(), f.begin(), f.end());
+    return matches;
+}
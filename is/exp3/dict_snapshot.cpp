@@ -0,0 +1,77 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "caesar_crack.hpp"
+#include "dict_snapshot.hpp"
+using namespace std;
+
+// Offline compile step for the crackers' dictionary: loads a word file or a
+// SCOWL final/ directory once and writes a snapshot that casesar_scowl
+// (--dict), exp3p1 and loadDictFile map instead of parsing.
+
+static void printUsage(const char *prog) {
+    cerr << "Usage: " << prog << " --dict PATH [--max-level N] --out FILE\n"
+         << "       " << prog << " --verify FILE\n"
+         << "  --dict PATH    word file or SCOWL final/ directory to compile\n"
+         << "  --max-level N  highest SCOWL size level loaded from a directory (default 95)\n"
+         << "  --out FILE     snapshot to write; it is read back and checked afterwards\n"
+         << "  --verify FILE  check a snapshot's header and payload checksums and print its header\n";
+}
+
+static double secondsSince(chrono::steady_clock::time_point t0) {
+    return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+// Load and fully check path; prints the header on success.
+static bool verifySnapshot(const string &path) {
+    auto t0 = chrono::steady_clock::now();
+    ScowlIndex dict;
+    DictSnapshotHeader h;
+    string err;
+    if (!loadDictSnapshot(path, dict, err, true, &h)) {
+        cerr << "Error: " << err << '\n';
+        return false;
+    }
+    double secs = secondsSince(t0);
+    size_t n = 0;
+    dict.forEach([&](string_view w, ScowlEntry) { n += dict.contains(w); });
+    if (n != dict.size()) {
+        cerr << "Error: " << path << ": " << dict.size() - n << " words not found through the table\n";
+        return false;
+    }
+    cerr << path << ": version " << h.version << ", " << h.words << " words, " << h.slotCount << " slots, "
+         << h.poolBytes << " pool bytes, max level " << h.maxLevel << ", from " << h.source << '\n'
+         << "  checksums OK (mapped and verified in " << secs * 1000 << " ms)\n";
+    return true;
+}
+
+int main(int argc, char **argv) {
+    string dictPath, outPath, verifyPath;
+    int maxLevel = 95;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--dict" && hasValue) dictPath = argv[++i];
+        else if (arg == "--max-level" && hasValue) maxLevel = atoi(argv[++i]);
+        else if (arg == "--out" && hasValue) outPath = argv[++i];
+        else if (arg == "--verify" && hasValue) verifyPath = argv[++i];
+        else { printUsage(argv[0]); return 2; }
+    }
+    if (!verifyPath.empty()) return verifySnapshot(verifyPath) ? 0 : 1;
+    if (dictPath.empty() || outPath.empty()) { printUsage(argv[0]); return 2; }
+
+    auto t0 = chrono::steady_clock::now();
+    string err;
+    ScowlIndex dict = loadDictFile(dictPath, maxLevel, &err);
+    if (dict.empty()) {
+        cerr << "Error: " << (err.empty() ? "no words loaded from " + dictPath : err) << '\n';
+        return 1;
+    }
+    cerr << "Loaded " << dict.size() << " words in " << secondsSince(t0) * 1000 << " ms.\n";
+    if (!writeDictSnapshot(dict, outPath, maxLevel, dictPath, err)) {
+        cerr << "Error: " << err << '\n';
+        return 1;
+    }
+    return verifySnapshot(outPath) ? 0 : 1;
+}
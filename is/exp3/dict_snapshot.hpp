@@ -0,0 +1,191 @@
+#pragma once
+// Binary dictionary snapshots: a ScowlIndex written out once (dict_snapshot
+// tool) and mapped back read-only, so startup does no parsing, lowercasing
+// or rehashing. Layout, all little-endian as written by this machine:
+//
+//   [0, 128)                 DictSnapshotHeader
+//   [slotsOffset, +slots*8)  ScowlIndex::Slot table, exactly as built
+//   [poolOffset, +poolBytes) word pool the slots point into
+//
+// Opening checks the magic, version, header checksum, that both sections
+// fit in the file, and makes one pass over the slot table (8 bytes a slot)
+// so that a corrupted payload cannot make lookups read outside the pool or
+// probe forever. The payload checksum covers the table and pool and is only
+// recomputed on request, since doing it would touch every page of the
+// mapping.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "caesar_stream.hpp"
+#include "scowl_index.hpp"
+
+constexpr char DICT_SNAPSHOT_MAGIC[8] = {'S', 'C', 'W', 'L', 'S', 'N', 'A', 'P'};
+// Bump when the slot layout, the header or ScowlIndex::hashWord changes.
+constexpr uint32_t DICT_SNAPSHOT_VERSION = 1;
+
+struct DictSnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerBytes;     // sizeof(DictSnapshotHeader)
+    uint64_t words;
+    uint64_t slotCount;       // power of two
+    uint64_t slotsOffset;
+    uint64_t poolOffset;
+    uint64_t poolBytes;
+    uint64_t payloadChecksum; // dictSnapshotChecksum of table then pool
+    uint32_t maxLevel;        // SCOWL level the lists were loaded up to (informational)
+    uint32_t reserved;
+    char source[48];          // what it was built from, truncated (informational)
+    uint64_t headerChecksum;  // dictSnapshotChecksum of every byte above
+};
+static_assert(sizeof(DictSnapshotHeader) == 128, "snapshot header layout");
+static_assert(sizeof(ScowlIndex::Slot) == 8, "snapshot slot layout");
+
+// 64-bit multiply-xor hash, 8 bytes per step (FNV-1a per byte would cost
+// several times more on a multi-megabyte table). Chained through seed.
+inline uint64_t dictSnapshotChecksum(const void *data, size_t n, uint64_t seed = 1469598103934665603ull) {
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    uint64_t h = seed ^ n;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * 0x9e3779b97f4a7c15ull;
+        h ^= h >> 32;
+    }
+    uint64_t tail = 0;
+    if (n > i) memcpy(&tail, p + i, n - i);
+    h = (h ^ tail) * 0x9e3779b97f4a7c15ull;
+    return h ^ (h >> 29);
+}
+
+inline uint64_t dictSnapshotHeaderChecksum(const DictSnapshotHeader &h) {
+    return dictSnapshotChecksum(&h, offsetof(DictSnapshotHeader, headerChecksum));
+}
+
+inline uint64_t dictSnapshotPayloadChecksum(const ScowlIndex::Slot *slots, size_t slotCount, const char *pool,
+                                            size_t poolBytes) {
+    uint64_t h = dictSnapshotChecksum(slots, slotCount * sizeof(ScowlIndex::Slot));
+    return dictSnapshotChecksum(pool, poolBytes, h);
+}
+
+// Every occupied slot lies inside the pool and exactly words slots are
+// occupied, which leaves at least one empty slot to end every probe
+// (the header check already guarantees words < slotCount).
+inline bool dictSnapshotSlotsValid(const ScowlIndex::Slot *slots, size_t slotCount, size_t poolBytes, size_t words) {
+    size_t used = 0;
+    for (size_t i = 0; i < slotCount; ++i) {
+        const ScowlIndex::Slot &s = slots[i];
+        if (s.len == 0) continue;
+        if (s.offset > poolBytes || s.len > poolBytes - s.offset) return false;
+        ++used;
+    }
+    return used == words;
+}
+
+// True if path starts with the snapshot magic (cheap: reads 8 bytes).
+inline bool isDictSnapshot(const std::string &path) {
+    FILE *f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+    char magic[8];
+    bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic) && memcmp(magic, DICT_SNAPSHOT_MAGIC, 8) == 0;
+    fclose(f);
+    return ok;
+}
+
+// Write dict as a snapshot. Returns false (with err) on I/O failure.
+inline bool writeDictSnapshot(const ScowlIndex &dict, const std::string &path, int maxLevel,
+                              const std::string &source, std::string &err) {
+    DictSnapshotHeader h{};
+    memcpy(h.magic, DICT_SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.version = DICT_SNAPSHOT_VERSION;
+    h.headerBytes = sizeof(DictSnapshotHeader);
+    h.words = dict.size();
+    h.slotCount = dict.slotCount();
+    h.slotsOffset = sizeof(DictSnapshotHeader);
+    h.poolOffset = h.slotsOffset + h.slotCount * sizeof(ScowlIndex::Slot);
+    h.poolBytes = dict.poolBytes();
+    h.payloadChecksum = dictSnapshotPayloadChecksum(dict.slotData(), dict.slotCount(), dict.poolData(), dict.poolBytes());
+    h.maxLevel = static_cast<uint32_t>(maxLevel);
+    strncpy(h.source, source.c_str(), sizeof(h.source) - 1);
+    h.headerChecksum = dictSnapshotHeaderChecksum(h);
+
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) {
+        err = "cannot create " + path;
+        return false;
+    }
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    if (ok && h.slotCount) ok = fwrite(dict.slotData(), sizeof(ScowlIndex::Slot), h.slotCount, f) == h.slotCount;
+    if (ok && h.poolBytes) ok = fwrite(dict.poolData(), 1, h.poolBytes, f) == h.poolBytes;
+    ok = (fclose(f) == 0) && ok;
+    if (!ok) err = "write failed: " + path;
+    return ok;
+}
+
+// Map a snapshot into out. The index points straight into the mapping,
+// which stays alive as long as any copy of it does. verifyPayload also
+// recomputes the table/pool checksum (reads the whole file).
+inline bool loadDictSnapshot(const std::string &path, ScowlIndex &out, std::string &err, bool verifyPayload = false,
+                             DictSnapshotHeader *headerOut = nullptr) {
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        err = "cannot open " + path;
+        return false;
+    }
+    auto map = std::make_shared<MappedFile>();
+    bool mapped = map->map(fd, false);
+    ::close(fd);
+    if (!mapped || map->size() < sizeof(DictSnapshotHeader)) {
+        err = path + ": too small to be a dictionary snapshot";
+        return false;
+    }
+    DictSnapshotHeader h;
+    memcpy(&h, map->data(), sizeof(h));
+    if (memcmp(h.magic, DICT_SNAPSHOT_MAGIC, sizeof(h.magic)) != 0) {
+        err = path + ": not a dictionary snapshot";
+        return false;
+    }
+    if (h.version != DICT_SNAPSHOT_VERSION || h.headerBytes != sizeof(DictSnapshotHeader)) {
+        err = path + ": snapshot version " + std::to_string(h.version) + ", expected " +
+              std::to_string(DICT_SNAPSHOT_VERSION) + " (rebuild it with dict_snapshot)";
+        return false;
+    }
+    if (h.headerChecksum != dictSnapshotHeaderChecksum(h)) {
+        err = path + ": header checksum mismatch";
+        return false;
+    }
+    const uint64_t size = map->size();
+    bool geometry = h.slotCount >= 16 && (h.slotCount & (h.slotCount - 1)) == 0 && h.words < h.slotCount &&
+                    h.slotsOffset % alignof(ScowlIndex::Slot) == 0 && h.slotsOffset >= sizeof(h) && h.slotsOffset <= size &&
+                    h.slotCount <= (size - h.slotsOffset) / sizeof(ScowlIndex::Slot) && h.poolOffset <= size &&
+                    h.poolBytes <= size - h.poolOffset && h.poolBytes <= UINT32_MAX;
+    if (!geometry) {
+        err = path + ": truncated or inconsistent snapshot";
+        return false;
+    }
+    const auto *slots = reinterpret_cast<const ScowlIndex::Slot *>(map->data() + h.slotsOffset);
+    const char *pool = map->data() + h.poolOffset;
+    if (!dictSnapshotSlotsValid(slots, h.slotCount, h.poolBytes, h.words)) {
+        err = path + ": corrupted slot table";
+        return false;
+    }
+    if (verifyPayload && dictSnapshotPayloadChecksum(slots, h.slotCount, pool, h.poolBytes) != h.payloadChecksum) {
+        err = path + ": payload checksum mismatch";
+        return false;
+    }
+    if (headerOut) *headerOut = h;
+    out = ScowlIndex::fromTable(map, pool, h.poolBytes, slots, h.slotCount, h.words);
+    return true;
+#else
+    (void)out; (void)verifyPayload; (void)headerOut;
+    err = "dictionary snapshots need mmap: " + path;
+    return false;
+#endif
+}
@@ -1,21 +1,43 @@
 #include <iostream>
 #include <string>
+#include <cstdlib>
+#include "caesar_kernel.hpp"
+#include "caesar_stream.hpp"
+#include "cli_args.hpp"
 using namespace std;
 
 string caesarCipher(string text, int key) {
-    string result = "";
-    
-    for (char c : text) {
-        if (isalpha(c)) { 
-            char base = isupper(c) ? 'A' : 'a';  
-            c = (c - base + key) % 26 + base;  
+    caesarShiftInPlace(text, key);
+    return text;
+}
+
+int main(int argc, char **argv) {
+    // Batch mode: exp3 --key K [--in FILE] [--out FILE]
+    if (argc > 1) {
+        string inPath, outPath;
+        int key = 0;
+        bool haveKey = false, ok = true;
+        for (int i = 1; i < argc && ok; ++i) {
+            string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--in" && hasValue) inPath = argv[++i];
+            else if (arg == "--out" && hasValue) outPath = argv[++i];
+            else if (arg == "--key" && hasValue) ok = haveKey = parseShiftKey(argv[++i], key);
+            else ok = false;
+        }
+        if (!ok || !haveKey) {
+            cerr << "Usage: " << argv[0] << " --key K [--in FILE] [--out FILE]\n"
+                 << "  K is a whole number (shift), applied mod 26\n";
+            return 2;
         }
-        result += c; 
+        string err;
+        if (!caesarTransformStream(inPath, outPath, key, err)) {
+            cerr << "Error: " << err << endl;
+            return 1;
+        }
+        return 0;
     }
-    return result;
-}
 
-int main() {
     string message;
     int key;
     cout << "60009220195 Devansh Jollani";
@@ -1,74 +1,76 @@
 #include <iostream>
 #include <fstream>
-#include <unordered_set>
 #include <string>
 #include <cstdlib>
 #include <ctime>
-#include <sstream>
+#include <string_view>
+#include <cctype>
 #include <algorithm>
-
-//Caesar Cipher Encrypt
-std::string caesarEncrypt(const std::string& text, int key) {
-    std::string result;
-    for (char c : text) {
-        if (isupper(c)) {
-            result += char((c - 'A' + key) % 26 + 'A');
-        } else if (islower(c)) {
-            result += char((c - 'a' + key) % 26 + 'a');
-        } else {
-            result += c; 
-        }
-    }
-    return result;
+#include "caesar_kernel.hpp"
+#include "dict_snapshot.hpp"
+#include "scowl_index.hpp"
+#include "scratch_arena.hpp"
+
+//Caesar Cipher Encrypt (into a caller buffer, reused between calls)
+void caesarEncrypt(std::string_view text, int key, std::string& out) {
+    caesarShiftInto(text, key, out);
 }
 
 //Caesar Cipher Decrypt
-std::string caesarDecrypt(const std::string& text, int key) {
-    std::string result;
-    for (char c : text) {
-        if (isupper(c)) {
-            result += char((c - 'A' - key + 26) % 26 + 'A');
-        } else if (islower(c)) {
-            result += char((c - 'a' - key + 26) % 26 + 'a');
-        } else {
-            result += c;
-        }
-    }
-    return result;
+void caesarDecrypt(std::string_view text, int key, std::string& out) {
+    caesarShiftInto(text, -key, out);
 }
 
 //Load Dictionary tokenize
-std::unordered_set<std::string> loadDictionary(const std::string& filename) {
-    std::unordered_set<std::string> dict;
+//A dict_snapshot file is mapped instead of parsed
+ScowlIndex loadDictionary(const std::string& filename) {
+    if (isDictSnapshot(filename)) {
+        ScowlIndex mapped;
+        std::string err;
+        if (!loadDictSnapshot(filename, mapped, err)) std::cerr << "Warning: " << err << std::endl;
+        return mapped;
+    }
+    ScowlIndex::Builder dict;
     std::ifstream file(filename);
     std::string word;
     while (file >> word) {
         std::transform(word.begin(), word.end(), word.begin(), ::tolower);
-        dict.insert(word);
+        dict.add(word);
     }
-    return dict;
+    return dict.build();
 }
 
 //Score Decryption
 //how many words are valid dictionary words
-int scoreDecryption(const std::string& text, const std::unordered_set<std::string>& dict) {
-    std::stringstream ss(text);
-    std::string word;
+//Whitespace-separated tokens with punctuation dropped, lowercased into one
+//scratch buffer and looked up as a string_view (no allocation per word).
+int scoreDecryption(const std::string& text, const ScowlIndex& dict) {
+    ScratchSpan buf(text.size());
+    size_t len = 0;
+    bool inWord = false;
     int score = 0;
-    while (ss >> word) {
-        
-        word.erase(std::remove_if(word.begin(), word.end(),
-                                  [](char c){ return ispunct(c); }), word.end());
-        std::transform(word.begin(), word.end(), word.begin(), ::tolower);
-        if (dict.count(word)) {
+    auto endWord = [&]() {
+        if (inWord && dict.contains(std::string_view(buf.data(), len))) {
             score++;
         }
+        len = 0;
+        inWord = false;
+    };
+    for (unsigned char c : text) {
+        if (isspace(c)) {
+            endWord();
+            continue;
+        }
+        inWord = true;
+        if (!ispunct(c)) buf.data()[len++] = static_cast<char>(tolower(c));
     }
+    endWord();
     return score;
 }
 
-int main() {
-    auto dict = loadDictionary("words.txt");
+//Usage: exp3p1 [DICTIONARY]   (word list or dict_snapshot file, default words.txt)
+int main(int argc, char** argv) {
+    auto dict = loadDictionary(argc > 1 ? argv[1] : "words.txt");
     std::cout << "60009220195 Devansh Jollani: ";
 
 
@@ -81,7 +83,8 @@ int main() {
     int randomKey = 1 + std::rand() % 25; 
 
     //Encrypt plaintext
-    std::string ciphertext = caesarEncrypt(plaintext, randomKey);
+    std::string ciphertext;
+    caesarEncrypt(plaintext, randomKey, ciphertext);
 
     //Show random key and ciphertext
     std::cout << "\n[Encryption]" << std::endl;
@@ -92,9 +95,10 @@ int main() {
     int bestKey = 0;
     int bestScore = -1;
     std::string bestDecryption;
+    std::string attempt; //one buffer for all 25 keys
 
     for (int key = 1; key < 26; key++) {
-        std::string attempt = caesarDecrypt(ciphertext, key);
+        caesarDecrypt(ciphertext, key, attempt);
         int score = scoreDecryption(attempt, dict);
         if (score > bestScore) {
             bestScore = score;
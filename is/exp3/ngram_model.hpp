@@ -0,0 +1,199 @@
+#pragma once
+// Letter n-gram log-probability model trained from SCOWL word lists.
+// The table is a flat float array of 26^N entries indexed arithmetically
+// (((a*26)+b)*26+c)..., so scoring is a multiply-add and one load per
+// position. Words are weighted by SCOWL size level: common (low level)
+// words count more than rare ones, standing in for real text frequency.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "scowl_index.hpp"
+
+template <int N>
+class NgramModel {
+public:
+    static constexpr size_t TABLE_SIZE = [] {
+        size_t s = 1;
+        for (int i = 0; i < N; ++i) s *= 26;
+        return s;
+    }();
+
+    NgramModel() : logp_(TABLE_SIZE, 0.0f) {}
+
+    // Add every n-gram inside `word` (a word or any run of letters a..z)
+    // with the given weight.
+    void addWord(std::string_view word, double weight) {
+        if (word.size() < N) return;
+        if (counts_.empty()) counts_.assign(TABLE_SIZE, 0.0);
+        size_t idx = 0;
+        for (size_t i = 0; i < word.size(); ++i) {
+            int c = word[i] - 'a';
+            if (c < 0 || c > 25) return;
+            idx = (idx * 26 + static_cast<size_t>(c)) % TABLE_SIZE;
+            if (i + 1 >= N) {
+                counts_[idx] += weight;
+                total_ += weight;
+            }
+        }
+    }
+
+    // Turn counts into log10 probabilities; unseen n-grams get a floor
+    // a bit below the rarest observed one.
+    void finalize() {
+        if (total_ <= 0.0) return;
+        floor_ = static_cast<float>(std::log10(0.01 / total_));
+        for (size_t i = 0; i < TABLE_SIZE; ++i) {
+            logp_[i] = counts_[i] > 0.0 ? static_cast<float>(std::log10(counts_[i] / total_)) : floor_;
+        }
+        counts_.clear();
+        counts_.shrink_to_fit();
+    }
+
+    float logp(size_t index) const { return logp_[index]; }
+    const float *table() const { return logp_.data(); }
+    float floorLogp() const { return floor_; }
+    bool trained() const { return total_ > 0.0; }
+    double totalWeight() const { return total_; }
+
+    // Sum of log-probabilities over letter indices (0..25), n - N + 1 terms.
+    double score(const uint8_t *letters, size_t n) const {
+        if (n < N) return 0.0;
+        double s = 0.0;
+        size_t idx = 0;
+        for (int i = 0; i < N - 1; ++i) idx = idx * 26 + letters[i];
+        for (size_t i = N - 1; i < n; ++i) {
+            idx = (idx * 26 + letters[i]) % TABLE_SIZE;
+            s += logp_[idx];
+        }
+        return s;
+    }
+
+private:
+    std::vector<float> logp_;
+    std::vector<double> counts_;
+    double total_ = 0.0;
+    float floor_ = -10.0f;
+};
+
+// Relative weight of a word from a given SCOWL level (10 common .. 95 rare).
+inline double scowlLevelWeight(int level) {
+    if (level <= 0) return 1.0;
+    return std::pow(2.0, (95.0 - level) / 10.0);
+}
+
+// Most frequent English words in rank order. SCOWL says which words exist
+// but not how often they occur; running text is dominated by these.
+inline const std::vector<std::string> &englishTopWords() {
+    static const std::vector<std::string> words = {
+        "the", "of", "and", "to", "a", "in", "is", "you", "that", "it", "he", "was", "for", "on", "are",
+        "as", "with", "his", "they", "i", "at", "be", "this", "have", "from", "or", "one", "had", "by",
+        "word", "but", "not", "what", "all", "were", "we", "when", "your", "can", "said", "there", "use",
+        "an", "each", "which", "she", "do", "how", "their", "if", "will", "up", "other", "about", "out",
+        "many", "then", "them", "these", "so", "some", "her", "would", "make", "like", "him", "into",
+        "time", "has", "look", "two", "more", "write", "go", "see", "number", "no", "way", "could",
+        "people", "my", "than", "first", "water", "been", "call", "who", "oil", "its", "now", "find",
+        "long", "down", "day", "did", "get", "come", "made", "may", "part"};
+    return words;
+}
+
+// Share of the model's n-gram weight that comes from the synthetic running
+// text rather than from the word lists. The lists alone have no n-grams
+// across word boundaries and no function-word frequencies; a larger share
+// lets the hundred words above outweigh the whole dictionary.
+constexpr double RUNNING_TEXT_SHARE = 0.25;
+
+// Fraction of the synthetic words drawn from englishTopWords; the rest are
+// common SCOWL words.
+constexpr double RUNNING_TEXT_TOP_WORDS = 0.55;
+
+// Synthetic running text (no spaces) from Zipf-weighted top words mixed
+// with `common` words, so word-boundary n-grams and function-word
+// frequencies are represented alongside the in-word n-grams. Call after
+// the word lists are added: the text is weighted to make up `share` of
+// the model's total.
+template <int N>
+void addSyntheticRunningText(NgramModel<N> &model, const std::vector<std::string> &common,
+                             double share = RUNNING_TEXT_SHARE) {
+    if (share <= 0.0 || share >= 1.0) return;
+    const std::vector<std::string> &top = englishTopWords();
+    std::vector<double> zipf(top.size());
+    double acc = 0.0;
+    for (size_t i = 0; i < top.size(); ++i) zipf[i] = acc += 1.0 / static_cast<double>(i + 1);
+
+    // Fixed LCG so the model is the same on every run.
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    auto next = [&state] {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return static_cast<double>(state >> 11) * (1.0 / 9007199254740992.0);
+    };
+    const size_t SYNTHETIC_WORDS = 400000;
+    std::string text;
+    for (size_t i = 0; i < SYNTHETIC_WORDS; ++i) {
+        if (next() < RUNNING_TEXT_TOP_WORDS) {
+            double r = next() * acc;
+            text += top[static_cast<size_t>(std::lower_bound(zipf.begin(), zipf.end(), r) - zipf.begin())];
+        } else {
+            text += common[static_cast<size_t>(next() * static_cast<double>(common.size()))];
+        }
+    }
+    if (text.size() < N) return;
+    double ngrams = static_cast<double>(text.size() - (N - 1));
+    double listWeight = model.totalWeight() > 0.0 ? model.totalWeight() : ngrams;
+    double weight = share / (1.0 - share) * listWeight / ngrams;
+    // Overlapping chunks (N - 1 letters) so n-grams run on across them.
+    for (size_t at = 0; at + N <= text.size(); at += 4096) {
+        model.addWord(std::string_view(text).substr(at, 4096 + N - 1), weight);
+    }
+}
+
+// Train from the SCOWL word lists (english/american "words" category) in
+// dir up to maxLevel: every word contributes its internal n-grams, then
+// the synthetic running text built from the level <= 35 words. Returns
+// false if no list could be read.
+template <int N>
+bool trainNgramModelFromScowl(NgramModel<N> &model, const std::string &dir, int maxLevel = 70) {
+    std::vector<std::string> files = listScowlFiles(dir, maxLevel, SCOWL_WORDS, {"english", "american"});
+    std::string w, cleaned;
+    std::vector<std::string> common;
+    for (const auto &f : files) {
+        std::string spelling;
+        ScowlEntry e;
+        parseScowlListName(f, spelling, e);
+        std::ifstream in(f);
+        double weight = scowlLevelWeight(e.level);
+        while (in >> w) {
+            cleanDictWord(w, cleaned);
+            model.addWord(cleaned, weight);
+            if (e.level <= 35 && !cleaned.empty()) common.push_back(cleaned);
+        }
+    }
+    if (common.empty()) return false;
+    addSyntheticRunningText(model, common);
+    model.finalize();
+    return model.trained();
+}
+
+// The same training from an index that is already loaded (its "words"
+// entries up to maxLevel), so a cracker need not read the lists twice.
+// Index order stands in for file order when sampling common words.
+template <int N>
+bool trainNgramModelFromIndex(NgramModel<N> &model, const ScowlIndex &dict, int maxLevel = 70) {
+    std::vector<std::string> common;
+    dict.forEach([&](std::string_view w, ScowlEntry e) {
+        if (!(e.categories & SCOWL_WORDS) || e.level > maxLevel) return;
+        model.addWord(w, scowlLevelWeight(e.level));
+        if (e.level <= 35) common.emplace_back(w);
+    });
+    if (common.empty()) return false;
+    addSyntheticRunningText(model, common);
+    model.finalize();
+    return model.trained();
+}
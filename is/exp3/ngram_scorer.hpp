@@ -0,0 +1,119 @@
+#pragma once
+// Caesar key scoring with letter bigram + trigram log-probabilities.
+// Only letters are scored (case-folded, everything else dropped), so the
+// score does not depend on word boundaries: it works the same on text
+// whose spaces were stripped, where dictionary word matching finds
+// nothing. Each position adds two table loads from the flat NgramModel
+// arrays; the AVX2 kernel shifts 8 positions per step and gathers both
+// tables at once.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "caesar_kernel.hpp"
+#include "ngram_model.hpp"
+#include "scowl_index.hpp"
+
+struct CaesarNgramModel {
+    NgramModel<2> bigrams;
+    NgramModel<3> trigrams;
+
+    bool trained() const { return bigrams.trained() && trigrams.trained(); }
+};
+
+// Both tables from the "words" entries of an already loaded dictionary.
+inline bool trainCaesarNgramModel(CaesarNgramModel &m, const ScowlIndex &dict, int maxLevel = 70) {
+    return trainNgramModelFromIndex(m.bigrams, dict, maxLevel) && trainNgramModelFromIndex(m.trigrams, dict, maxLevel);
+}
+
+// Letter indices 0..25 of p[0, n) into out (room for n); returns how many.
+inline size_t ngramLetters(const char *p, size_t n, uint8_t *out) {
+    const auto &idx = letterIndexTable();
+    size_t m = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t c = idx[static_cast<unsigned char>(p[i])];
+        out[m] = c;
+        m += c < 26;
+    }
+    return m;
+}
+
+// Position i of a letter stream contributes bigram (i, i+1) and trigram
+// (i, i+1, i+2); the last bigram (n-2, n-1) has no trigram.
+inline double ngramScoreScalar(const uint8_t *x, size_t begin, size_t n, int key, const float *bi, const float *tri) {
+    if (n < 2) return 0.0;
+    auto dec = [key](uint8_t c) { return static_cast<size_t>(c >= key ? c - key : c + 26 - key); };
+    double s = 0.0;
+    for (size_t i = begin; i + 2 < n; ++i) {
+        size_t b = dec(x[i]) * 26 + dec(x[i + 1]);
+        s += bi[b] + tri[b * 26 + dec(x[i + 2])];
+    }
+    return s + bi[dec(x[n - 2]) * 26 + dec(x[n - 1])];
+}
+
+#ifdef CAESAR_KERNEL_X86
+
+// Positions [0, done) of the stream, 8 at a time; adds into sum and
+// returns done. Each step reads 16 bytes, so up to 16 are left over.
+// Lanes accumulate in float and are flushed to sum every
+// NGRAM_FLUSH_STEPS steps, before rounding error can build up.
+__attribute__((target("avx2")))
+inline size_t ngramScoreAVX2(const uint8_t *x, size_t n, int key, const float *bi, const float *tri, double &sum) {
+    const size_t NGRAM_FLUSH_STEPS = 1024;
+    const __m128i k = _mm_set1_epi8(static_cast<char>(key));
+    const __m128i k26 = _mm_set1_epi8(static_cast<char>(26 - key));
+    const __m256i m26 = _mm256_set1_epi32(26);
+    size_t i = 0;
+    while (i + 16 <= n) {
+        __m256 acc = _mm256_setzero_ps();
+        for (size_t step = 0; step < NGRAM_FLUSH_STEPS && i + 16 <= n; ++step, i += 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(x + i));
+            // c >= key ? c - key : c + 26 - key   (letters are 0..25, so signed compares are safe)
+            __m128i low = _mm_cmpgt_epi8(k, v);
+            __m128i d = _mm_blendv_epi8(_mm_sub_epi8(v, k), _mm_add_epi8(v, k26), low);
+            __m256i a = _mm256_cvtepu8_epi32(d);
+            __m256i b = _mm256_cvtepu8_epi32(_mm_srli_si128(d, 1));
+            __m256i c = _mm256_cvtepu8_epi32(_mm_srli_si128(d, 2));
+            __m256i i2 = _mm256_add_epi32(_mm256_mullo_epi32(a, m26), b);
+            __m256i i3 = _mm256_add_epi32(_mm256_mullo_epi32(i2, m26), c);
+            acc = _mm256_add_ps(acc, _mm256_i32gather_ps(bi, i2, 4));
+            acc = _mm256_add_ps(acc, _mm256_i32gather_ps(tri, i3, 4));
+        }
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, acc);
+        for (float f : lanes) sum += f;
+    }
+    return i;
+}
+
+#endif // CAESAR_KERNEL_X86
+
+using NgramScoreFn = size_t (*)(const uint8_t *, size_t, int, const float *, const float *, double &);
+
+// nullptr means scalar only.
+struct NgramKernel {
+    const char *name;
+    NgramScoreFn score;
+};
+
+inline const NgramKernel &ngramKernel() {
+    static const NgramKernel k = [] {
+#ifdef CAESAR_KERNEL_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return NgramKernel{"avx2", &ngramScoreAVX2};
+#endif
+        return NgramKernel{"scalar", nullptr};
+    }();
+    return k;
+}
+
+// Sum of bigram + trigram log10 probabilities of the letter stream x[0, n)
+// decrypted with key.
+inline double ngramScoreForKey(const uint8_t *x, size_t n, int key, const CaesarNgramModel &m) {
+    key = normalizeKey(key);
+    const float *bi = m.bigrams.table(), *tri = m.trigrams.table();
+    const NgramKernel &k = ngramKernel();
+    double sum = 0.0;
+    size_t done = k.score ? k.score(x, n, key, bi, tri, sum) : 0;
+    return sum + ngramScoreScalar(x, done, n, key, bi, tri);
+}
@@ -1,14 +1,18 @@
 
 #include <cstdio>
+#include <vector>
 
-#include "deaccent.hh"
+#include "deaccent_simd.hh"
 
 using namespace std;
 
 int main() {
-  int c;
-  while ( c = getchar(), c != -1 ) 
+  // Whole blocks instead of getchar/putchar, translated in place.
+  vector<char> buf(DEACCENT_BLOCK);
+  size_t n;
+  while ( (n = fread(&buf[0], 1, buf.size(), stdin)) != 0 )
   {
-    putchar(deaccent(c));
+    deaccent_block(&buf[0], &buf[0], n);
+    if (fwrite(&buf[0], 1, n, stdout) != n) return 1;
   }
 }
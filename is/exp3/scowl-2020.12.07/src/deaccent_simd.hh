@@ -0,0 +1,202 @@
+#ifndef DEACCENT_SIMD_HH
+#define DEACCENT_SIMD_HH
+
+// Block versions of deaccent() for deaccent and find-accented.
+//
+// deaccent_lookup only changes bytes 0xC0..0xFF, so a block is copied as-is
+// unless some byte has both top bits set. Those 64 bytes are translated
+// with a 64-entry table: one vpermb on AVX-512 VBMI, or four 16-entry
+// pshufb lookups with AVX2 / SSSE3. Everything else uses the plain table.
+
+#include <cstddef>
+#include <cstring>
+#include "deaccent.hh"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define DEACCENT_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// Block I/O size for both tools.
+static const size_t DEACCENT_BLOCK = 1 << 20;
+
+inline void deaccent_scalar(const char *in, char *out, size_t n) {
+  for (size_t i = 0; i != n; ++i) out[i] = deaccent(in[i]);
+}
+
+// Index of the first byte in [p, p+n) that deaccent() changes, or n.
+inline size_t find_accented_scalar(const char *p, size_t n) {
+  for (size_t i = 0; i != n; ++i)
+    if (p[i] != deaccent(p[i])) return i;
+  return n;
+}
+
+#ifdef DEACCENT_SIMD_X86
+
+__attribute__((target("ssse3")))
+inline size_t deaccent_ssse3(const char *in, char *out, size_t n) {
+  const unsigned char *t = deaccent_lookup + 0xC0;
+  const __m128i t0 = _mm_loadu_si128((const __m128i *)(t));
+  const __m128i t1 = _mm_loadu_si128((const __m128i *)(t + 16));
+  const __m128i t2 = _mm_loadu_si128((const __m128i *)(t + 32));
+  const __m128i t3 = _mm_loadu_si128((const __m128i *)(t + 48));
+  const __m128i high = _mm_set1_epi8((char)0xC0);
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+  const __m128i b4 = _mm_set1_epi8(0x10), b5 = _mm_set1_epi8(0x20);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i c = _mm_loadu_si128((const __m128i *)(in + i));
+    __m128i top = _mm_cmpeq_epi8(_mm_and_si128(c, high), high);
+    if (_mm_movemask_epi8(top)) {
+      __m128i lo = _mm_and_si128(c, nibble);
+      __m128i s4 = _mm_cmpeq_epi8(_mm_and_si128(c, b4), b4);
+      __m128i s5 = _mm_cmpeq_epi8(_mm_and_si128(c, b5), b5);
+      __m128i a = _mm_or_si128(_mm_and_si128(s4, _mm_shuffle_epi8(t1, lo)), _mm_andnot_si128(s4, _mm_shuffle_epi8(t0, lo)));
+      __m128i b = _mm_or_si128(_mm_and_si128(s4, _mm_shuffle_epi8(t3, lo)), _mm_andnot_si128(s4, _mm_shuffle_epi8(t2, lo)));
+      __m128i v = _mm_or_si128(_mm_and_si128(s5, b), _mm_andnot_si128(s5, a));
+      c = _mm_or_si128(_mm_and_si128(top, v), _mm_andnot_si128(top, c));
+    }
+    _mm_storeu_si128((__m128i *)(out + i), c);
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+inline size_t deaccent_avx2(const char *in, char *out, size_t n) {
+  const unsigned char *t = deaccent_lookup + 0xC0;
+  const __m256i t0 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(t)));
+  const __m256i t1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(t + 16)));
+  const __m256i t2 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(t + 32)));
+  const __m256i t3 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(t + 48)));
+  const __m256i high = _mm256_set1_epi8((char)0xC0);
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  const __m256i b4 = _mm256_set1_epi8(0x10), b5 = _mm256_set1_epi8(0x20);
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i c = _mm256_loadu_si256((const __m256i *)(in + i));
+    __m256i top = _mm256_cmpeq_epi8(_mm256_and_si256(c, high), high);
+    if (_mm256_movemask_epi8(top)) {
+      __m256i lo = _mm256_and_si256(c, nibble);
+      __m256i s4 = _mm256_cmpeq_epi8(_mm256_and_si256(c, b4), b4);
+      __m256i s5 = _mm256_cmpeq_epi8(_mm256_and_si256(c, b5), b5);
+      __m256i a = _mm256_blendv_epi8(_mm256_shuffle_epi8(t0, lo), _mm256_shuffle_epi8(t1, lo), s4);
+      __m256i b = _mm256_blendv_epi8(_mm256_shuffle_epi8(t2, lo), _mm256_shuffle_epi8(t3, lo), s4);
+      c = _mm256_blendv_epi8(c, _mm256_blendv_epi8(a, b, s5), top);
+    }
+    _mm256_storeu_si256((__m256i *)(out + i), c);
+  }
+  return i;
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vbmi")))
+inline size_t deaccent_avx512vbmi(const char *in, char *out, size_t n) {
+  // vpermb uses the low 6 bits of each byte: exactly c - 0xC0 for the high range.
+  const __m512i table = _mm512_loadu_si512(deaccent_lookup + 0xC0);
+  const __m512i high = _mm512_set1_epi8((char)0xC0);
+  size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    __m512i c = _mm512_loadu_si512(in + i);
+    __mmask64 top = _mm512_cmpeq_epi8_mask(_mm512_and_si512(c, high), high);
+    if (top) c = _mm512_mask_permutexvar_epi8(c, top, c, table);
+    _mm512_storeu_si512(out + i, c);
+  }
+  return i;
+}
+
+// Offset of the first byte >= 0xC0 in the prefix handled, or the prefix
+// length (a multiple of the vector width) if there is none.
+__attribute__((target("sse2")))
+inline size_t find_high_sse2(const char *p, size_t n) {
+  const __m128i high = _mm_set1_epi8((char)0xC0);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i c = _mm_loadu_si128((const __m128i *)(p + i));
+    int m = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(c, high), high));
+    if (m) return i + __builtin_ctz(m);
+  }
+  return i;
+}
+
+__attribute__((target("avx2")))
+inline size_t find_high_avx2(const char *p, size_t n) {
+  const __m256i high = _mm256_set1_epi8((char)0xC0);
+  size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(p + i));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(p + i + 32));
+    __m256i ma = _mm256_cmpeq_epi8(_mm256_and_si256(a, high), high);
+    __m256i mb = _mm256_cmpeq_epi8(_mm256_and_si256(b, high), high);
+    if (_mm256_testz_si256(_mm256_or_si256(ma, mb), _mm256_or_si256(ma, mb))) continue;
+    unsigned long long m = (unsigned)_mm256_movemask_epi8(ma) | ((unsigned long long)(unsigned)_mm256_movemask_epi8(mb) << 32);
+    return i + __builtin_ctzll(m);
+  }
+  return i;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline size_t find_high_avx512(const char *p, size_t n) {
+  const __m512i high = _mm512_set1_epi8((char)0xC0);
+  size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    __m512i c = _mm512_loadu_si512(p + i);
+    __mmask64 m = _mm512_cmpeq_epi8_mask(_mm512_and_si512(c, high), high);
+    if (m) return i + __builtin_ctzll(m);
+  }
+  return i;
+}
+
+#endif // DEACCENT_SIMD_X86
+
+typedef size_t (*deaccent_block_fn)(const char *, char *, size_t);
+typedef size_t (*find_high_fn)(const char *, size_t);
+
+inline deaccent_block_fn deaccent_kernel() {
+  static const deaccent_block_fn fn = []() -> deaccent_block_fn {
+#ifdef DEACCENT_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw")) return &deaccent_avx512vbmi;
+    if (__builtin_cpu_supports("avx2")) return &deaccent_avx2;
+    if (__builtin_cpu_supports("ssse3")) return &deaccent_ssse3;
+#endif
+    return 0;
+  }();
+  return fn;
+}
+
+inline find_high_fn find_high_kernel() {
+  static const find_high_fn fn = []() -> find_high_fn {
+#ifdef DEACCENT_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) return &find_high_avx512;
+    if (__builtin_cpu_supports("avx2")) return &find_high_avx2;
+    if (__builtin_cpu_supports("sse2")) return &find_high_sse2;
+#endif
+    return 0;
+  }();
+  return fn;
+}
+
+// deaccent() over n bytes (in == out is fine).
+inline void deaccent_block(const char *in, char *out, size_t n) {
+  deaccent_block_fn fn = deaccent_kernel();
+  size_t done = fn ? fn(in, out, n) : 0;
+  deaccent_scalar(in + done, out + done, n - done);
+}
+
+// Index of the first byte in [p, p+n) that deaccent() changes, or n.
+// Runs of bytes below 0xC0 (which deaccent never changes) are skipped in bulk.
+inline size_t find_accented(const char *p, size_t n) {
+  find_high_fn fn = find_high_kernel();
+  size_t i = 0;
+  while (i < n) {
+    // j is the first high byte at or after i, or where the vector loop stopped.
+    size_t j = i + (fn ? fn(p + i, n - i) : 0);
+    if (j == n) return n;
+    if (((unsigned char)p[j] & 0xC0) != 0xC0) return j + find_accented_scalar(p + j, n - j);
+    if (p[j] != deaccent(p[j])) return j;
+    i = j + 1; // high byte that deaccent keeps (e.g. 0xDF)
+  }
+  return n;
+}
+
+#endif
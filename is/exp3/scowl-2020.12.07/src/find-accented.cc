@@ -1,20 +1,46 @@
 
-#include <iostream>
-#include <string>
-#include "deaccent.hh"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "deaccent_simd.hh"
 
 using namespace std;
 
+// Prints every line (as read by getline) that deaccent() would change.
+// Input is read in blocks; find_accented skips clean text in bulk and
+// only the lines around a hit are looked at.
 int main() {
-  int c;
-  string line;
-  while ( getline(cin, line) ) 
+  vector<char> buf(DEACCENT_BLOCK);
+  size_t have = 0;  // bytes in buf, starting at a line boundary
+  bool eof = false;
+  while (!eof || have)
     {
-      for (unsigned int i = 0; i != line.size(); ++i) {
-	if (line[i] != deaccent(line[i])) {
-	  cout << line << '\n';
-	  break;
-	}
+      if (!eof) {
+        if (have == buf.size()) buf.resize(buf.size() * 2); // line longer than the buffer
+        size_t got = fread(&buf[have], 1, buf.size() - have, stdin);
+        if (got == 0) eof = true;
+        have += got;
       }
+      const char *p = &buf[0];
+      // Complete lines only, unless this is the unterminated last one.
+      const char *last_nl = (const char *)memrchr(p, '\n', have);
+      size_t lines_end = last_nl ? (size_t)(last_nl - p) + 1 : 0;
+      if (eof) lines_end = have;
+      if (lines_end == 0) continue;
+
+      size_t pos = 0;
+      while (pos < lines_end) {
+        size_t hit = pos + find_accented(p + pos, lines_end - pos);
+        if (hit >= lines_end) break;
+        const char *start = (const char *)memrchr(p + pos, '\n', hit - pos);
+        size_t line_begin = start ? (size_t)(start - p) + 1 : pos;
+        const char *end = (const char *)memchr(p + hit, '\n', lines_end - hit);
+        size_t line_end = end ? (size_t)(end - p) : lines_end;
+        fwrite(p + line_begin, 1, line_end - line_begin, stdout);
+        putchar('\n');
+        pos = line_end + 1;
+      }
+      memmove(&buf[0], p + lines_end, have - lines_end);
+      have -= lines_end;
     }
 }
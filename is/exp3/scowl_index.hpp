@@ -0,0 +1,284 @@
+#pragma once
+// Compact read-only word index for the SCOWL lists.
+// All words live back to back in one character pool; an open-addressing
+// table of 8-byte slots points into it and carries each word's smallest
+// SCOWL size level (10..95) and the OR of the categories it appeared in.
+// Lookups take std::string_view and never allocate. The pool and table
+// are immutable once built, so copies share them, and they can just as
+// well live in a mapped file (dict_snapshot.hpp).
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+
+// Category bits, from the list name (e.g. "british_variant_1-proper-names.80").
+enum ScowlCategory : uint8_t {
+    SCOWL_WORDS = 1 << 0,
+    SCOWL_PROPER_NAMES = 1 << 1,
+    SCOWL_ABBREVIATIONS = 1 << 2,
+    SCOWL_VARIANTS = 1 << 3,      // spelling variants (variant_N lists)
+    SCOWL_UPPER = 1 << 4,
+    SCOWL_CONTRACTIONS = 1 << 5,
+    SCOWL_SPECIAL = 1 << 6,       // special-hacker, special-roman-numerals
+    SCOWL_ALL = 0x7f,
+};
+
+// Level 0 means "not from a SCOWL list" (plain word files, builtin dict).
+struct ScowlEntry {
+    uint8_t level = 0;
+    uint8_t categories = 0;
+};
+
+// Parse "<spelling>-<category>.<level>". Returns false for other names.
+inline bool parseScowlListName(std::string_view name, std::string &spelling, ScowlEntry &entry) {
+    size_t slash = name.find_last_of("/\\");
+    if (slash != std::string_view::npos) name.remove_prefix(slash + 1);
+    size_t dash = name.find('-');
+    size_t dot = name.rfind('.');
+    if (dash == std::string_view::npos || dot == std::string_view::npos || dot < dash) return false;
+    std::string_view levelStr = name.substr(dot + 1);
+    if (levelStr.empty() || levelStr.size() > 2 ||
+        !std::all_of(levelStr.begin(), levelStr.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)); }))
+        return false;
+    std::string_view category = name.substr(dash + 1, dot - dash - 1);
+
+    spelling.assign(name.data(), dash);
+    entry.level = static_cast<uint8_t>(std::stoi(std::string(levelStr)));
+    if (category == "words") entry.categories = SCOWL_WORDS;
+    else if (category == "proper-names") entry.categories = SCOWL_PROPER_NAMES;
+    else if (category == "abbreviations") entry.categories = SCOWL_ABBREVIATIONS;
+    else if (category == "upper") entry.categories = SCOWL_UPPER;
+    else if (category == "contractions") entry.categories = SCOWL_CONTRACTIONS;
+    else if (spelling == "special") entry.categories = SCOWL_SPECIAL;
+    else return false;
+    if (spelling.find("variant") != std::string::npos) entry.categories |= SCOWL_VARIANTS;
+    return true;
+}
+
+// Dictionary form used by the crackers: lowercase, letters only ("a's" -> "as").
+inline void cleanDictWord(std::string_view w, std::string &out) {
+    out.clear();
+    for (unsigned char uc : w) {
+        char c = static_cast<char>(tolower(uc));
+        if (isalpha(static_cast<unsigned char>(c))) out.push_back(c);
+    }
+}
+
+class ScowlIndex {
+public:
+    // 8-byte table slot; len == 0 marks an empty slot.
+    struct Slot {
+        uint32_t offset;
+        uint16_t len;
+        uint8_t level;
+        uint8_t categories;
+    };
+
+    ScowlIndex() = default;
+
+    // Collects words (duplicates merge: lowest level, OR of categories),
+    // then freezes them into a ScowlIndex.
+    class Builder {
+    public:
+        void add(std::string_view word, ScowlEntry entry = {}) {
+            if (word.empty() || word.size() > 0xffff) return;
+            Item it;
+            it.offset = static_cast<uint32_t>(pool_.size());
+            it.len = static_cast<uint16_t>(word.size());
+            it.entry = entry;
+            pool_.append(word.data(), word.size());
+            items_.push_back(it);
+        }
+
+        // Add every whitespace-separated word of a file after cleanDictWord.
+        bool addFile(const std::string &path, ScowlEntry entry = {}) {
+            std::ifstream in(path);
+            if (!in) return false;
+            std::string w, cleaned;
+            while (in >> w) {
+                cleanDictWord(w, cleaned);
+                add(cleaned, entry);
+            }
+            return true;
+        }
+
+        ScowlIndex build() {
+            // Sort so duplicates are adjacent and the final pool is ordered.
+            std::sort(items_.begin(), items_.end(), [this](const Item &a, const Item &b) {
+                return view(a) < view(b);
+            });
+            size_t unique = 0;
+            for (size_t i = 0; i < items_.size(); ++i) {
+                if (i == 0 || view(items_[i]) != view(items_[i - 1])) ++unique;
+            }
+            size_t cap = 16;
+            while (cap < unique + unique / 2) cap <<= 1; // load factor <= 2/3
+            auto owned = std::make_shared<Owned>();
+            owned->slots.assign(cap, Slot{0, 0, 0, 0});
+            owned->pool.reserve(pool_.size());
+
+            for (size_t i = 0; i < items_.size();) {
+                std::string_view w = view(items_[i]);
+                ScowlEntry merged = items_[i].entry;
+                size_t j = i + 1;
+                for (; j < items_.size() && view(items_[j]) == w; ++j) {
+                    const ScowlEntry &e = items_[j].entry;
+                    if (e.level != 0 && (merged.level == 0 || e.level < merged.level)) merged.level = e.level;
+                    merged.categories |= e.categories;
+                }
+                Slot s{static_cast<uint32_t>(owned->pool.size()), static_cast<uint16_t>(w.size()),
+                       merged.level, merged.categories};
+                owned->pool.append(w.data(), w.size());
+                size_t h = hashWord(w) & (cap - 1);
+                while (owned->slots[h].len != 0) h = (h + 1) & (cap - 1);
+                owned->slots[h] = s;
+                i = j;
+            }
+            items_.clear();
+            pool_.clear();
+            const Owned &o = *owned;
+            return ScowlIndex(owned, o.pool.data(), o.pool.size(), o.slots.data(), o.slots.size(), unique, false);
+        }
+
+    private:
+        struct Item {
+            uint32_t offset;
+            uint16_t len;
+            ScowlEntry entry;
+        };
+        std::string_view view(const Item &it) const { return std::string_view(pool_.data() + it.offset, it.len); }
+
+        std::string pool_;
+        std::vector<Item> items_;
+    };
+
+    // Index over a table and pool someone else owns (e.g. a mapped
+    // snapshot); owner keeps them alive. slotCount must be a power of two
+    // and the table laid out exactly as Builder::build() lays it out.
+    static ScowlIndex fromTable(std::shared_ptr<const void> owner, const char *pool, size_t poolBytes,
+                                const Slot *slots, size_t slotCount, size_t words) {
+        return ScowlIndex(std::move(owner), pool, poolBytes, slots, slotCount, words, true);
+    }
+
+    // FNV-1a; words are short so a simple byte loop is fine.
+    static uint64_t hashWord(std::string_view w) {
+        uint64_t h = 1469598103934665603ull;
+        for (unsigned char c : w) {
+            h ^= c;
+            h *= 1099511628211ull;
+        }
+        return h ^ (h >> 29);
+    }
+
+    // nullptr if absent.
+    const Slot *findSlot(std::string_view w) const {
+        if (slotCount_ == 0 || w.empty()) return nullptr;
+        size_t h = hashWord(w) & mask_;
+        for (;;) {
+            const Slot &s = slots_[h];
+            if (s.len == 0) return nullptr;
+            if (s.len == w.size() && memcmp(pool_ + s.offset, w.data(), w.size()) == 0) return &s;
+            h = (h + 1) & mask_;
+        }
+    }
+
+    bool contains(std::string_view w) const { return findSlot(w) != nullptr; }
+
+    // Level/category info; false if the word is absent.
+    bool lookup(std::string_view w, ScowlEntry &out) const {
+        const Slot *s = findSlot(w);
+        if (!s) return false;
+        out.level = s->level;
+        out.categories = s->categories;
+        return true;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t memoryBytes() const { return poolBytes_ + slotCount_ * sizeof(Slot); }
+    // True if the table lives in memory this index did not build (a snapshot).
+    bool external() const { return external_; }
+
+    // Raw table and pool, for writing snapshots.
+    const Slot *slotData() const { return slots_; }
+    size_t slotCount() const { return slotCount_; }
+    const char *poolData() const { return pool_; }
+    size_t poolBytes() const { return poolBytes_; }
+
+    // Visit every (word, entry) pair, in table order.
+    template <class F>
+    void forEach(F fn) const {
+        for (size_t i = 0; i < slotCount_; ++i) {
+            const Slot &s = slots_[i];
+            if (s.len != 0) fn(std::string_view(pool_ + s.offset, s.len), ScowlEntry{s.level, s.categories});
+        }
+    }
+
+private:
+    struct Owned {
+        std::string pool;
+        std::vector<Slot> slots;
+    };
+
+    ScowlIndex(std::shared_ptr<const void> owner, const char *pool, size_t poolBytes, const Slot *slots,
+               size_t slotCount, size_t words, bool external)
+        : owner_(std::move(owner)), pool_(pool), slots_(slots), poolBytes_(poolBytes), slotCount_(slotCount),
+          mask_(slotCount ? slotCount - 1 : 0), size_(words), external_(external) {}
+
+    std::shared_ptr<const void> owner_; // keeps pool_/slots_ alive
+    const char *pool_ = nullptr;
+    const Slot *slots_ = nullptr;
+    size_t poolBytes_ = 0;
+    size_t slotCount_ = 0;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+    bool external_ = false;
+};
+
+// SCOWL list files in dir whose level <= maxLevel, category intersects
+// categoryMask, and spelling is in `spellings` (empty = any).
+inline std::vector<std::string> listScowlFiles(const std::string &dir, int maxLevel = 95,
+                                               uint8_t categoryMask = SCOWL_ALL,
+                                               const std::vector<std::string> &spellings = {}) {
+    std::vector<std::string> files;
+#ifndef _WIN32
+    DIR *d = opendir(dir.c_str());
+    if (!d) return files;
+    while (dirent *ent = readdir(d)) {
+        std::string spelling;
+        ScowlEntry e;
+        if (!parseScowlListName(ent->d_name, spelling, e)) continue;
+        if (e.level > maxLevel || !(e.categories & categoryMask)) continue;
+        if (!spellings.empty() && std::find(spellings.begin(), spellings.end(), spelling) == spellings.end()) continue;
+        files.push_back(dir + "/" + ent->d_name);
+    }
+    closedir(d);
+    std::sort(files.begin(), files.end());
+#else
+    (void)dir; (void)maxLevel; (void)categoryMask; (void)spellings;
+#endif
+    return files;
+}
+
+// Index over the given files. SCOWL-named files get their level/category;
+// anything else is indexed as plain words at level 0.
+inline ScowlIndex buildScowlIndex(const std::vector<std::string> &files) {
+    ScowlIndex::Builder b;
+    for (const auto &f : files) {
+        std::string spelling;
+        ScowlEntry e;
+        if (!parseScowlListName(f, spelling, e)) e = ScowlEntry{0, SCOWL_WORDS};
+        b.addFile(f, e);
+    }
+    return b.build();
+}
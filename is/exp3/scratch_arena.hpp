@@ -0,0 +1,84 @@
+#pragma once
+// Per-thread scratch memory for the scoring hot paths.
+// Each thread keeps a list of blocks that only ever grows; ScratchSpan
+// borrows bytes from it and hands them back when it goes out of scope
+// (strictly nested, like the stack). After the first few messages every
+// request fits in blocks that already exist, so scoring allocates nothing.
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+class ScratchArena {
+public:
+    struct Mark {
+        size_t block;
+        size_t used;
+    };
+
+    Mark mark() const { return Mark{current_, used_}; }
+    void release(Mark m) {
+        current_ = m.block;
+        used_ = m.used;
+    }
+
+    // n bytes, valid until the mark taken before this call is released.
+    char *alloc(size_t n) {
+        if (n == 0) n = 1;
+        while (current_ < blocks_.size() && used_ + n > blocks_[current_].size) {
+            ++current_;
+            used_ = 0;
+        }
+        if (current_ == blocks_.size()) {
+            size_t size = std::max(n, blocks_.empty() ? MIN_BLOCK : blocks_.back().size * 2);
+            blocks_.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+        }
+        char *p = blocks_[current_].data.get() + used_;
+        used_ += n;
+        return p;
+    }
+
+    // Bytes held across all blocks.
+    size_t capacity() const {
+        size_t n = 0;
+        for (const Block &b : blocks_) n += b.size;
+        return n;
+    }
+
+private:
+    static constexpr size_t MIN_BLOCK = 64 * 1024;
+
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+    std::vector<Block> blocks_;
+    size_t current_ = 0;
+    size_t used_ = 0;
+};
+
+inline ScratchArena &threadScratch() {
+    thread_local ScratchArena arena;
+    return arena;
+}
+
+// n bytes of the calling thread's scratch, returned on destruction.
+class ScratchSpan {
+public:
+    explicit ScratchSpan(size_t n)
+        : arena_(threadScratch()), mark_(arena_.mark()), data_(arena_.alloc(n)), size_(n) {}
+    ~ScratchSpan() { arena_.release(mark_); }
+
+    ScratchSpan(const ScratchSpan &) = delete;
+    ScratchSpan &operator=(const ScratchSpan &) = delete;
+
+    char *data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    ScratchArena &arena_;
+    ScratchArena::Mark mark_;
+    char *data_;
+    size_t size_;
+};
@@ -0,0 +1,132 @@
+#pragma once
+// Shift-invariant view of a dictionary for Caesar cracking.
+// Every word is rotated so its first letter becomes 'a' ("hello" ->
+// "axeeh"); all Caesar shifts of a word share that form. Each form maps to
+// a 26-bit mask of the first letters that make real words, so one lookup
+// per ciphertext word says exactly which keys turn it into a dictionary
+// word: key = (cipherFirst - plainFirst) mod 26 for each set bit.
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "crack_stats.hpp"
+#include "scowl_index.hpp"
+#include "word_tokens.hpp"
+
+// Rotate lowercase letters so w[0] becomes 'a', into out (room for
+// w.size()). Returns false if w holds anything but a..z.
+inline bool rotationNormalizeInto(std::string_view w, char *out) {
+    if (w.empty()) return false;
+    int first = w[0] - 'a';
+    for (size_t i = 0; i < w.size(); ++i) {
+        int c = w[i] - 'a';
+        if (c < 0 || c > 25) return false;
+        out[i] = static_cast<char>('a' + (c - first + 26) % 26);
+    }
+    return true;
+}
+
+inline bool rotationNormalize(std::string_view w, std::string &out) {
+    out.resize(w.size());
+    return rotationNormalizeInto(w, &out[0]);
+}
+
+class ShiftInvariantIndex {
+public:
+    // Bit f of dictMask: rotating the form so 'a' -> 'a'+f gives a dictionary
+    // word. commonMask is the same for the caller's "very common" list.
+    struct Slot {
+        uint32_t offset;
+        uint32_t len;      // 0 = empty
+        uint32_t dictMask;
+        uint32_t commonMask;
+    };
+
+    ShiftInvariantIndex() = default;
+
+    ShiftInvariantIndex(const ScowlIndex &dict, const std::vector<std::string> &common) {
+        std::vector<std::pair<std::string, std::pair<uint32_t, uint32_t>>> forms;
+        forms.reserve(dict.size() + common.size());
+        std::string norm;
+        dict.forEach([&](std::string_view w, ScowlEntry) {
+            if (rotationNormalize(w, norm)) forms.push_back({norm, {1u << (w[0] - 'a'), 0u}});
+        });
+        for (const auto &w : common) {
+            if (rotationNormalize(w, norm)) forms.push_back({norm, {0u, 1u << (w[0] - 'a')}});
+        }
+
+        size_t cap = 16;
+        while (cap < forms.size() + forms.size() / 2) cap <<= 1;
+        slots_.assign(cap, Slot{0, 0, 0, 0});
+        mask_ = cap - 1;
+        for (const auto &f : forms) {
+            size_t h = ScowlIndex::hashWord(f.first) & mask_;
+            for (;; h = (h + 1) & mask_) {
+                Slot &s = slots_[h];
+                if (s.len == 0) {
+                    s.offset = static_cast<uint32_t>(pool_.size());
+                    s.len = static_cast<uint32_t>(f.first.size());
+                    pool_ += f.first;
+                    ++size_;
+                } else if (s.len != f.first.size() || memcmp(pool_.data() + s.offset, f.first.data(), s.len) != 0) {
+                    continue;
+                }
+                s.dictMask |= f.second.first;
+                s.commonMask |= f.second.second;
+                break;
+            }
+        }
+    }
+
+    // nullptr if no dictionary word has this rotation-normal form.
+    const Slot *find(std::string_view norm) const {
+        if (slots_.empty() || norm.empty()) return nullptr;
+        size_t h = ScowlIndex::hashWord(norm) & mask_;
+        for (;; h = (h + 1) & mask_) {
+            const Slot &s = slots_[h];
+            if (s.len == 0) return nullptr;
+            if (s.len == norm.size() && memcmp(pool_.data() + s.offset, norm.data(), norm.size()) == 0) return &s;
+        }
+    }
+
+    size_t size() const { return size_; }
+    size_t memoryBytes() const { return pool_.capacity() + slots_.capacity() * sizeof(Slot); }
+
+private:
+    std::string pool_;
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+};
+
+// Per-key word statistics for all 26 decryption keys at once.
+struct ShiftVotes {
+    std::array<int, 26> matches{};
+    std::array<int, 26> commonHits{};
+    int totalWords = 0;
+};
+
+// Tokenize like splitWordsLower (lowercased alnum runs, as views into
+// per-thread scratch) and credit every key that turns a token into a
+// dictionary / common word. Tokens containing digits count as words but
+// can never match.
+inline ShiftVotes tallyShiftVotes(std::string_view text, const ShiftInvariantIndex &idx) {
+    ShiftVotes v;
+    ScratchSpan lower(text.size());
+    ScratchSpan norm(text.size());
+    lowerWordChars(text.data(), text.size(), lower.data());
+    CRACK_STAT_SCOPE(VoteTally);
+    v.totalWords = static_cast<int>(forEachSeparatedWord(lower.data(), text.size(), [&](std::string_view word) {
+        if (!rotationNormalizeInto(word, norm.data())) return;
+        if (const ShiftInvariantIndex::Slot *s = idx.find(std::string_view(norm.data(), word.size()))) {
+            int c0 = word[0] - 'a';
+            for (uint32_t m = s->dictMask; m; m &= m - 1) v.matches[(c0 - __builtin_ctz(m) + 26) % 26]++;
+            for (uint32_t m = s->commonMask; m; m &= m - 1) v.commonHits[(c0 - __builtin_ctz(m) + 26) % 26]++;
+        }
+    }));
+    return v;
+}
@@ -0,0 +1,180 @@
+#pragma once
+// Tiered, lazily loaded SCOWL dictionary for the Caesar cracker.
+// Only the smallest tier (the most common words) is loaded up front. A
+// message whose best key is not clearly right -- low match ratio, or too
+// close to the runner-up -- is rescored against the next tier, which is
+// loaded the first time any message needs it. Each tier indexes every
+// list up to its level, so a score is still one lookup per word. That also
+// makes every tier a superset of the ones below it: once a higher tier is
+// loaded, messages start there and the lower tiers are released (callers
+// still scoring against one keep it alive until they finish).
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "caesar_crack.hpp"
+
+struct DictTier {
+    int maxLevel;
+    uint8_t categories;
+};
+
+// SCOWL levels 20, 35 and 60 without proper names, then everything up to
+// maxLevel. Tiers above maxLevel are dropped.
+inline std::vector<DictTier> defaultDictTiers(int maxLevel = 95) {
+    const uint8_t common = SCOWL_ALL & ~SCOWL_PROPER_NAMES;
+    std::vector<DictTier> tiers;
+    for (int level : {20, 35, 60}) {
+        if (level < maxLevel) tiers.push_back(DictTier{level, common});
+    }
+    tiers.push_back(DictTier{maxLevel, SCOWL_ALL});
+    return tiers;
+}
+
+// When a tier's answer is accepted.
+struct TierThresholds {
+    double minRatio = 0.75;   // best key's dictionary match ratio
+    double minMargin = 0.25;  // best ratio minus the runner-up's
+};
+
+inline bool isConfidentCandidate(const Candidate &c, const TierThresholds &t) {
+    return c.score.ratio >= t.minRatio && c.score.ratio - c.runnerUp.ratio >= t.minMargin;
+}
+
+class TieredDict {
+public:
+    // dir is a SCOWL final/ directory. Tier 0 is loaded here; use
+    // loadedWords() to check that the directory held any lists.
+    TieredDict(std::string dir, std::vector<DictTier> tiers, CrackStrategy strategy,
+               TierThresholds thresholds = {}, std::ostream *log = nullptr)
+        : dir_(std::move(dir)), strategy_(strategy), thresholds_(thresholds), log_(log) {
+        for (const DictTier &t : tiers) {
+            slots_.push_back(std::make_unique<Slot>());
+            slots_.back()->spec = t;
+        }
+        size_t first = 0;
+        if (!slots_.empty()) acquire(first);
+    }
+
+    ~TieredDict() {
+        for (std::thread &t : prefetchers_) t.join();
+    }
+
+    TieredDict(const TieredDict &) = delete;
+    TieredDict &operator=(const TieredDict &) = delete;
+
+    size_t tierCount() const { return slots_.size(); }
+    const DictTier &tierSpec(size_t i) const { return slots_[i]->spec; }
+    bool isLoaded(size_t i) const { return slots_[i]->loaded.load(std::memory_order_acquire); }
+    // Messages settled by tier i so far.
+    uint64_t resolvedBy(size_t i) const { return slots_[i]->resolved.load(std::memory_order_relaxed); }
+
+    // Words in the largest loaded tier (it contains every smaller one).
+    size_t loadedWords() const {
+        std::shared_ptr<const Tier> t = std::atomic_load(&slots_[top_.load(std::memory_order_acquire)]->data);
+        return t ? t->dict.size() : 0;
+    }
+
+    // Start loading tier i on a background thread (no-op if it is already
+    // loaded, loading, or out of range).
+    void prefetch(size_t i) const {
+        if (i >= slots_.size() || slots_[i]->prefetched.exchange(true)) return;
+        std::lock_guard<std::mutex> lock(threadsMutex_);
+        prefetchers_.emplace_back([this, i] {
+            CRACK_STAT_THREAD_START();
+            size_t j = i;
+            acquire(j);
+        });
+    }
+
+    // Best key using the smallest usable tier that answers with confidence
+    // (or the last tier). *tierUsed receives that tier's index.
+    Candidate crack(const std::string &cipher, size_t *tierUsed = nullptr) const {
+        Candidate best;
+        size_t i = top_.load(std::memory_order_acquire);
+        for (;; ++i) {
+            std::shared_ptr<const Tier> t = acquire(i);
+            best = pickBestCandidate(cipher, t->dict, t->opts);
+            if (i + 1 == slots_.size() || isConfidentCandidate(best, thresholds_)) break;
+            CRACK_STAT_ADD(DictEscalations, 1);
+            // Messages that need this tier tend to come in runs; have the
+            // next one ready before they need it.
+            prefetch(i + 2);
+        }
+        slots_[i]->resolved.fetch_add(1, std::memory_order_relaxed);
+        if (tierUsed) *tierUsed = i;
+        return best;
+    }
+
+private:
+    struct Tier {
+        ScowlIndex dict;
+        ShiftInvariantIndex shiftIndex;
+        CrackOptions opts;
+    };
+
+    struct Slot {
+        DictTier spec{};
+        std::once_flag once;
+        std::atomic<bool> loaded{false};     // has been loaded (it may be released since)
+        std::atomic<bool> prefetched{false};
+        std::atomic<uint64_t> resolved{0};
+        std::shared_ptr<const Tier> data;    // null until loaded and once released
+    };
+
+    // Tier i, loading it on first use (concurrent callers wait for the one
+    // that loads it). If it has been released, a higher tier is loaded: i
+    // moves up to the highest one, which is returned instead.
+    std::shared_ptr<const Tier> acquire(size_t &i) const {
+        Slot &s = *slots_[i];
+        std::call_once(s.once, [&] { load(s, i); });
+        for (;;) {
+            if (std::shared_ptr<const Tier> t = std::atomic_load(&slots_[i]->data)) return t;
+            i = top_.load(std::memory_order_acquire);
+        }
+    }
+
+    void load(Slot &s, size_t index) const {
+        auto t = std::make_shared<Tier>();
+        {
+            CRACK_STAT_SCOPE(LoadDict);
+            t->dict = buildScowlIndex(listScowlFiles(dir_, s.spec.maxLevel, s.spec.categories));
+        }
+        t->opts.strategy = strategy_;
+        if (strategy_ == CrackStrategy::Vote) {
+            t->shiftIndex = buildShiftIndex(t->dict);
+            t->opts.shiftIndex = &t->shiftIndex;
+        }
+        std::atomic_store(&s.data, std::shared_ptr<const Tier>(t));
+        s.loaded.store(true, std::memory_order_release);
+
+        // Publish it as the top tier if it is the highest so far, then drop
+        // everything below the top (this one too, if a higher tier won).
+        std::lock_guard<std::mutex> lock(threadsMutex_);
+        size_t top = top_.load(std::memory_order_relaxed);
+        if (index > top && t->dict.size() > 0) top_.store(top = index, std::memory_order_release);
+        for (size_t j = 0; j < top; ++j) std::atomic_store(&slots_[j]->data, std::shared_ptr<const Tier>());
+        if (log_) {
+            *log_ << "Loaded dictionary tier " << index
+                  << " (level <= " << s.spec.maxLevel << ", " << t->dict.size() << " words, "
+                  << t->dict.memoryBytes() / 1024 << " KiB)";
+            if (top > 0) *log_ << "; tiers below " << top << " released";
+            *log_ << ".\n";
+        }
+    }
+
+    std::string dir_;
+    CrackStrategy strategy_;
+    TierThresholds thresholds_;
+    std::ostream *log_;
+    std::vector<std::unique_ptr<Slot>> slots_;
+    mutable std::atomic<size_t> top_{0};  // highest loaded tier; never released
+    mutable std::mutex threadsMutex_;  // prefetchers_, releasing tiers and *log_
+    mutable std::vector<std::thread> prefetchers_;
+};
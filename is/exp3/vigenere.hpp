@@ -0,0 +1,359 @@
+#pragma once
+// Vigenère (polyalphabetic Caesar) transform and cracker.
+// Letters are shifted by successive key letters (a = 0 .. z = 25), case is
+// preserved, and anything else passes through without using up a key letter.
+//
+// Cracking: the period comes from a coincidence scan: for every candidate
+// period p, count positions where letter i equals letter i + p. That is
+// the index of coincidence of the p columns. It is about 0.066 when p is a
+// multiple of the key length and about 0.038 otherwise, and the compare is
+// a straight SIMD byte compare. Each column is then an ordinary Caesar
+// shift broken with chiSquareFromCounts, and the candidate periods are
+// compared by dictionary scoring of the first VIGENERE_CONFIRM_BYTES of
+// each decryption; only the winner is decrypted and scored in full.
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "caesar_crack.hpp"
+#include "caesar_stream.hpp"
+#include "work_pool.hpp"
+
+// ------------------ Transform ------------------
+
+// Key letters as shifts 0..25 (case-insensitive); other key characters are ignored.
+inline std::vector<uint8_t> vigenereShifts(std::string_view key) {
+    std::vector<uint8_t> shifts;
+    for (unsigned char c : key) {
+        if (isalpha(c)) shifts.push_back(static_cast<uint8_t>(tolower(c) - 'a'));
+    }
+    return shifts;
+}
+
+// Shift n bytes from in to out (may alias exactly). pos is the index into
+// shifts of the next letter and carries over between calls, so a stream can
+// be transformed chunk by chunk. An empty key copies the input.
+inline void vigenereShift(const char *in, char *out, size_t n, const std::vector<uint8_t> &shifts,
+                          bool decrypt, size_t &pos) {
+    if (shifts.empty()) {
+        if (in != out) memmove(out, in, n);
+        return;
+    }
+    const std::array<uint8_t, 256> &letter = letterIndexTable();
+    const size_t period = shifts.size();
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char c = static_cast<unsigned char>(in[i]);
+        unsigned idx = letter[c];
+        if (idx >= 26) {
+            out[i] = static_cast<char>(c);
+            continue;
+        }
+        unsigned s = decrypt ? 26u - shifts[pos] : shifts[pos];
+        unsigned r = idx + s;
+        if (r >= 26) r -= 26;
+        out[i] = static_cast<char>(c - idx + r); // c - idx is 'a' or 'A'
+        if (++pos == period) pos = 0;
+    }
+}
+
+// Whole-message transforms into a caller buffer (resized, out must not
+// overlap s) or in place. Callers looping over many messages with one key
+// can call vigenereShift with shifts computed once instead.
+inline void vigenereTransformInto(std::string_view s, std::string_view key, std::string &out, bool decrypt = false) {
+    out.resize(s.size());
+    size_t pos = 0;
+    vigenereShift(s.data(), &out[0], s.size(), vigenereShifts(key), decrypt, pos);
+}
+
+inline void vigenereTransformInPlace(std::string &s, std::string_view key, bool decrypt = false) {
+    size_t pos = 0;
+    vigenereShift(s.data(), &s[0], s.size(), vigenereShifts(key), decrypt, pos);
+}
+
+inline std::string vigenereTransform(const std::string &s, std::string_view key, bool decrypt = false) {
+    std::string out;
+    vigenereTransformInto(s, key, out, decrypt);
+    return out;
+}
+
+// As caesarTransformStream, with a Vigenère key.
+inline bool vigenereTransformStream(const std::string &inPath, const std::string &outPath,
+                                    std::string_view key, bool decrypt, std::string &err) {
+    ChunkedInput in;
+    ChunkedOutput out;
+    if (!in.open(inPath, err) || !out.open(outPath, err)) return false;
+
+    std::vector<uint8_t> shifts = vigenereShifts(key);
+    std::vector<char> outBuf(in.isMapped() ? CAESAR_STREAM_CHUNK : 0);
+    std::string_view chunk;
+    size_t pos = 0;
+    while (in.next(chunk)) {
+        char *dst = in.isMapped() ? outBuf.data() : in.scratch();
+        vigenereShift(chunk.data(), dst, chunk.size(), shifts, decrypt, pos);
+        if (!out.write(dst, chunk.size())) {
+            err = std::string("write failed: ") + strerror(errno);
+            return false;
+        }
+    }
+    if (in.failed()) {
+        err = std::string("read failed: ") + strerror(errno);
+        return false;
+    }
+    if (!out.close()) {
+        err = std::string("close failed: ") + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+// ------------------ Coincidence kernels ------------------
+
+// Number of i < n with a[i] == b[i].
+inline uint64_t coincidenceCountScalar(const uint8_t *a, const uint8_t *b, size_t n) {
+    uint64_t hits = 0;
+    for (size_t i = 0; i < n; ++i) hits += a[i] == b[i];
+    return hits;
+}
+
+#ifdef CAESAR_KERNEL_X86
+
+// Each returns the matches in the prefix it handled and sets done.
+__attribute__((target("sse2,popcnt")))
+inline uint64_t coincidenceCountSSE2(const uint8_t *a, const uint8_t *b, size_t n, size_t &done) {
+    uint64_t hits = 0;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+        hits += static_cast<uint64_t>(__builtin_popcount(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)))));
+    }
+    done = i;
+    return hits;
+}
+
+__attribute__((target("avx2,popcnt")))
+inline uint64_t coincidenceCountAVX2(const uint8_t *a, const uint8_t *b, size_t n, size_t &done) {
+    uint64_t hits = 0;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+        __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+        hits += static_cast<uint64_t>(__builtin_popcount(static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)))));
+    }
+    done = i;
+    return hits;
+}
+
+__attribute__((target("avx512f,avx512bw,popcnt")))
+inline uint64_t coincidenceCountAVX512(const uint8_t *a, const uint8_t *b, size_t n, size_t &done) {
+    uint64_t hits = 0;
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i x = _mm512_loadu_si512(a + i);
+        __m512i y = _mm512_loadu_si512(b + i);
+        hits += static_cast<uint64_t>(__builtin_popcountll(_mm512_cmpeq_epi8_mask(x, y)));
+    }
+    done = i;
+    return hits;
+}
+
+#endif // CAESAR_KERNEL_X86
+
+using CoincidenceCountFn = uint64_t (*)(const uint8_t *, const uint8_t *, size_t, size_t &);
+
+// Widest coincidence kernel for this CPU, resolved once; nullptr = scalar only.
+inline CoincidenceCountFn coincidenceKernel() {
+    static const CoincidenceCountFn fn = []() -> CoincidenceCountFn {
+#ifdef CAESAR_KERNEL_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512bw")) return &coincidenceCountAVX512;
+        if (__builtin_cpu_supports("avx2")) return &coincidenceCountAVX2;
+        if (__builtin_cpu_supports("sse2") && __builtin_cpu_supports("popcnt")) return &coincidenceCountSSE2;
+#endif
+        return nullptr;
+    }();
+    return fn;
+}
+
+inline uint64_t coincidenceCount(const uint8_t *a, const uint8_t *b, size_t n) {
+    size_t done = 0;
+    uint64_t hits = 0;
+    if (CoincidenceCountFn fn = coincidenceKernel()) hits = fn(a, b, n, done);
+    return hits + coincidenceCountScalar(a + done, b + done, n - done);
+}
+
+// ------------------ Cracker ------------------
+
+// Coincidence rate of English text vs uniformly random letters.
+const double VIGENERE_KAPPA_ENGLISH = 0.0667;
+const double VIGENERE_KAPPA_RANDOM = 0.0385;
+// Fewest letters per column a period needs before it is considered.
+const size_t VIGENERE_MIN_COLUMN_LETTERS = 6;
+// Bytes of ciphertext decrypted to compare candidate periods.
+const size_t VIGENERE_CONFIRM_BYTES = 1 << 16;
+// Letters per pool task when histogramming columns.
+const size_t VIGENERE_HISTOGRAM_GRAIN = 1 << 16;
+
+struct VigenereCrackOptions {
+    int maxPeriod = 100;
+    int candidates = 5;                  // periods confirmed with the dictionary
+    WorkStealingPool *pool = nullptr;    // nullptr: run on the calling thread
+};
+
+struct VigenereResult {
+    std::string key;                     // lowercase key letters
+    std::string plaintext;
+    double kappa = 0.0;                  // coincidence rate at the chosen period
+    Score score;
+};
+
+// Letters of text as 0..25, case folded; everything else dropped.
+inline std::vector<uint8_t> vigenereLetters(const std::string &text) {
+    const std::array<uint8_t, 256> &idx = letterIndexTable();
+    std::vector<uint8_t> letters;
+    letters.reserve(text.size());
+    for (unsigned char c : text) {
+        if (idx[c] < 26) letters.push_back(idx[c]);
+    }
+    return letters;
+}
+
+// kappa[p] for p in [1, maxPeriod]: fraction of i with letters[i] == letters[i + p].
+inline std::vector<double> vigenerePeriodKappa(const std::vector<uint8_t> &letters, int maxPeriod,
+                                               WorkStealingPool *pool = nullptr) {
+    std::vector<double> kappa(static_cast<size_t>(maxPeriod) + 1, 0.0);
+    auto scan = [&](size_t b, size_t e) {
+        for (size_t p = b + 1; p <= e; ++p) {
+            size_t n = letters.size() - p;
+            kappa[p] = static_cast<double>(coincidenceCount(letters.data(), letters.data() + p, n)) / static_cast<double>(n);
+        }
+    };
+    if (pool) pool->parallelFor(static_cast<size_t>(maxPeriod), 1, scan);
+    else scan(0, static_cast<size_t>(maxPeriod));
+    return kappa;
+}
+
+// Break every column of a period-p Vigenère as a Caesar shift: the key
+// letter is the rotation whose chi2 against English is lowest.
+inline std::string vigenereBreakColumns(const std::vector<uint8_t> &letters, int period,
+                                        WorkStealingPool *pool = nullptr) {
+    const size_t p = static_cast<size_t>(period);
+    size_t blocks = (letters.size() + VIGENERE_HISTOGRAM_GRAIN - 1) / VIGENERE_HISTOGRAM_GRAIN;
+    std::vector<std::vector<LetterCounts>> partial(std::max<size_t>(1, blocks), std::vector<LetterCounts>(p, LetterCounts{}));
+    auto histogram = [&](size_t b, size_t e) {
+        for (size_t blk = b; blk < e; ++blk) {
+            std::vector<LetterCounts> &cols = partial[blk];
+            size_t i = blk * VIGENERE_HISTOGRAM_GRAIN, end = std::min(letters.size(), i + VIGENERE_HISTOGRAM_GRAIN);
+            for (size_t col = i % p; i < end; ++i) {
+                cols[col][letters[i]]++;
+                if (++col == p) col = 0;
+            }
+        }
+    };
+    if (pool && blocks > 1) pool->parallelFor(blocks, 1, histogram);
+    else histogram(0, blocks);
+
+    std::string key(p, 'a');
+    auto solve = [&](size_t b, size_t e) {
+        for (size_t col = b; col < e; ++col) {
+            LetterCounts counts{};
+            for (const auto &cols : partial)
+                for (int j = 0; j < 26; ++j) counts[j] += cols[col][j];
+            int best = 0;
+            double bestChi = chiSquareFromCounts(counts, 0);
+            for (int rot = 1; rot < 26; ++rot) {
+                double chi = chiSquareFromCounts(counts, rot);
+                if (chi < bestChi) { bestChi = chi; best = rot; }
+            }
+            key[col] = static_cast<char>('a' + best);
+        }
+    };
+    if (pool && p > 1) pool->parallelFor(p, 8, solve);
+    else solve(0, p);
+    return key;
+}
+
+// Shortest key that repeats to give key ("abcabc" -> "abc").
+inline std::string vigenereMinimalKey(const std::string &key) {
+    for (size_t q = 1; q < key.size(); ++q) {
+        if (key.size() % q) continue;
+        bool periodic = true;
+        for (size_t i = q; i < key.size() && periodic; ++i) periodic = key[i] == key[i - q];
+        if (periodic) return key.substr(0, q);
+    }
+    return key;
+}
+
+// Candidate periods: the shortest one whose kappa is closer to English
+// than to random, then the highest-kappa others. Multiples of the key
+// length score high too; they are kept because a short false positive must
+// not hide the real period, and vigenereMinimalKey folds them back.
+inline std::vector<int> vigenereCandidatePeriods(const std::vector<double> &kappa, int candidates) {
+    const double threshold = 0.5 * (VIGENERE_KAPPA_RANDOM + VIGENERE_KAPPA_ENGLISH);
+    int maxPeriod = static_cast<int>(kappa.size()) - 1;
+    std::vector<int> order;
+    for (int p = 1; p <= maxPeriod; ++p) order.push_back(p);
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return kappa[a] > kappa[b]; });
+
+    std::vector<int> out;
+    for (int p = 1; p <= maxPeriod; ++p) {
+        if (kappa[p] >= threshold) {
+            out.push_back(p);
+            break;
+        }
+    }
+    for (int p : order) {
+        if (static_cast<int>(out.size()) >= candidates) break;
+        if (std::find(out.begin(), out.end(), p) == out.end()) out.push_back(p);
+    }
+    return out;
+}
+
+inline VigenereResult crackVigenere(const std::string &cipher, const ScowlIndex &dict,
+                                    const VigenereCrackOptions &opts = {}) {
+    VigenereResult best;
+    std::vector<uint8_t> letters = vigenereLetters(cipher);
+    if (letters.size() < 2) {
+        best.key = "a";
+        best.plaintext = cipher;
+        return best;
+    }
+    int maxPeriod = std::min<int>(std::max(1, opts.maxPeriod),
+                                  static_cast<int>(std::max<size_t>(1, letters.size() / VIGENERE_MIN_COLUMN_LETTERS)));
+    std::vector<double> kappa = vigenerePeriodKappa(letters, maxPeriod, opts.pool);
+
+    // Candidates are compared on a prefix; only the winner is decrypted in full.
+    const std::string sample = cipher.substr(0, VIGENERE_CONFIRM_BYTES);
+    std::vector<std::string> tried;
+    bool haveBest = false;
+    for (int period : vigenereCandidatePeriods(kappa, std::max(1, opts.candidates))) {
+        VigenereResult r;
+        r.key = vigenereMinimalKey(vigenereBreakColumns(letters, period, opts.pool));
+        if (std::find(tried.begin(), tried.end(), r.key) != tried.end()) continue;
+        tried.push_back(r.key);
+        r.kappa = kappa[period];
+        std::string pt = vigenereTransform(sample, r.key, true);
+        r.score = scoreWords(pt, dict);
+        r.score.chi2 = chiSquareForText(pt);
+        // Dictionary ratio, then chi2; a tie keeps the earlier candidate.
+        // (Coarser than isBetterCandidate, which also weighs commonHits.)
+        bool better = !haveBest || r.score.ratio > best.score.ratio + 1e-12 ||
+                      (std::fabs(r.score.ratio - best.score.ratio) < 1e-12 && r.score.chi2 < best.score.chi2);
+        if (better) {
+            best = std::move(r);
+            haveBest = true;
+        }
+    }
+    best.plaintext = vigenereTransform(cipher, best.key, true);
+    if (cipher.size() > sample.size()) {
+        best.score = scoreWords(best.plaintext, dict);
+        best.score.chi2 = chiSquareForText(best.plaintext);
+    }
+    return best;
+}
@@ -0,0 +1,59 @@
+#pragma once
+// Word tokenization for dictionary scoring: text is lowercased once into
+// per-thread scratch with every non-word byte turned into a separator,
+// and words are handed out as string_views into that buffer, so the
+// scoring loops never build a string per word.
+
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <string_view>
+
+#include "crack_stats.hpp"
+#include "scratch_arena.hpp"
+
+// Byte -> its lowercase form if that is a letter or digit, else 0.
+inline const std::array<char,256> &wordCharTable() {
+    static const std::array<char,256> table = [] {
+        std::array<char,256> t{};
+        for (int b = 0; b < 256; ++b) {
+            int c = std::tolower(b);
+            if (std::isalnum(c)) t[b] = static_cast<char>(c);
+        }
+        return t;
+    }();
+    return table;
+}
+
+// Lowercase p[0, n) into out, with every byte that is not a letter or
+// digit replaced by 0 (the word separator for forEachSeparatedWord).
+inline void lowerWordChars(const char *p, size_t n, char *out) {
+    CRACK_STAT_SCOPE(Tokenize);
+    const std::array<char,256> &table = wordCharTable();
+    for (size_t i = 0; i < n; ++i) out[i] = table[static_cast<unsigned char>(p[i])];
+}
+
+// fn(std::string_view) for every 0-separated word of buf; returns the count.
+template <class F>
+inline size_t forEachSeparatedWord(const char *buf, size_t n, F &&fn) {
+    size_t words = 0, start = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (buf[i] != 0) continue;
+        if (i > start) { fn(std::string_view(buf + start, i - start)); ++words; }
+        start = i + 1;
+    }
+    if (n > start) { fn(std::string_view(buf + start, n - start)); ++words; }
+    CRACK_STAT_ADD(WordsTokenized, words);
+    return words;
+}
+
+// Calls fn(std::string_view) for every lowercase word (run of letters and
+// digits) of [p, p+n). The text is lowercased once into per-thread scratch
+// and the views point into it, so they are only valid during the call.
+// Returns the number of words.
+template <class F>
+inline size_t forEachWordLower(const char *p, size_t n, F &&fn) {
+    ScratchSpan lower(n);
+    lowerWordChars(p, n, lower.data());
+    return forEachSeparatedWord(lower.data(), n, fn);
+}
@@ -0,0 +1,166 @@
+#pragma once
+// Small work-stealing thread pool.
+// Every worker owns a deque: it pushes and pops its own tasks at the back
+// (LIFO, cache-warm) and, when empty, steals from the front of a victim's
+// deque (FIFO, oldest and usually largest work first). parallelFor splits a
+// range into grains up front and lets stealing even out uneven task costs.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "crack_stats.hpp"
+
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    // threads == 0 means one per hardware thread.
+    explicit WorkStealingPool(unsigned threads = 0) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        count_ = threads;
+        queues_.reserve(threads);
+        for (unsigned i = 0; i < threads; ++i) queues_.push_back(std::make_unique<Queue>());
+        for (unsigned i = 0; i < threads; ++i) workers_.emplace_back([this, i] { run(i); });
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    // Finishes outstanding tasks, then joins the workers.
+    ~WorkStealingPool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lk(sleepMutex_);
+            stopping_ = true;
+        }
+        sleepCv_.notify_all();
+        for (auto &t : workers_) t.join();
+    }
+
+    unsigned size() const { return count_; }
+
+    // Called from a worker the task lands on that worker's own deque,
+    // otherwise queues are filled round-robin.
+    void submit(Task task) {
+        pending_.fetch_add(1, std::memory_order_relaxed);
+        int self = currentWorker();
+        unsigned q = self >= 0 ? static_cast<unsigned>(self)
+                               : nextQueue_.fetch_add(1, std::memory_order_relaxed) % size();
+        {
+            std::lock_guard<std::mutex> lk(queues_[q]->m);
+            queues_[q]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lk(sleepMutex_);
+            ++epoch_;
+        }
+        sleepCv_.notify_one();
+    }
+
+    // Block until every submitted task has finished. Must not be called from a worker.
+    void wait() {
+        std::unique_lock<std::mutex> lk(doneMutex_);
+        doneCv_.wait(lk, [this] { return pending_.load(std::memory_order_acquire) == 0; });
+    }
+
+    // fn(begin, end) over [0, n) in grains of `grain`; returns when all are done.
+    template <class F>
+    void parallelFor(size_t n, size_t grain, F fn) {
+        if (n == 0) return;
+        grain = std::max<size_t>(1, grain);
+        for (size_t b = 0; b < n; b += grain) {
+            size_t e = std::min(n, b + grain);
+            submit([fn, b, e] { fn(b, e); });
+        }
+        wait();
+    }
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<Task> tasks;
+    };
+
+    struct WorkerSlot {
+        const WorkStealingPool *pool = nullptr;
+        int id = -1;
+    };
+    static WorkerSlot &workerSlot() {
+        static thread_local WorkerSlot slot;
+        return slot;
+    }
+    // Index of the calling thread in this pool, or -1.
+    int currentWorker() const {
+        const WorkerSlot &s = workerSlot();
+        return s.pool == this ? s.id : -1;
+    }
+
+    bool popLocal(unsigned self, Task &out) {
+        Queue &q = *queues_[self];
+        std::lock_guard<std::mutex> lk(q.m);
+        if (q.tasks.empty()) return false;
+        out = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(unsigned self, Task &out) {
+        for (unsigned k = 1; k < size(); ++k) {
+            Queue &q = *queues_[(self + k) % size()];
+            std::lock_guard<std::mutex> lk(q.m);
+            if (q.tasks.empty()) continue;
+            out = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    void run(unsigned self) {
+        workerSlot() = WorkerSlot{this, static_cast<int>(self)};
+        CRACK_STAT_THREAD_START();
+        for (;;) {
+            uint64_t seen;
+            {
+                std::lock_guard<std::mutex> lk(sleepMutex_);
+                seen = epoch_;
+            }
+            Task task;
+            if (popLocal(self, task) || steal(self, task)) {
+                task();
+                if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    std::lock_guard<std::mutex> lk(doneMutex_);
+                    doneCv_.notify_all();
+                }
+                continue;
+            }
+            // Nothing found: sleep until a submit happens after our scan.
+            std::unique_lock<std::mutex> lk(sleepMutex_);
+            sleepCv_.wait(lk, [&] { return stopping_ || epoch_ != seen; });
+            if (stopping_) return;
+        }
+    }
+
+    unsigned count_ = 0;
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> pending_{0};
+    std::atomic<unsigned> nextQueue_{0};
+
+    std::mutex sleepMutex_;
+    std::condition_variable sleepCv_;
+    uint64_t epoch_ = 0;
+    bool stopping_ = false;
+
+    std::mutex doneMutex_;
+    std::condition_variable doneCv_;
+};
@@ -0,0 +1,324 @@
+#pragma once
+// Whole-file exp4 encryption/decryption on all cores.
+// The input is memory-mapped and cut into one chunk per thread. Only
+// letters count, in either direction: each cut is moved forward until the
+// letters before it are a whole number of transposition blocks, so every
+// chunk but the last maps to complete output blocks at a known offset and
+// only the last one pads (encrypt) or completes a partial block (decrypt).
+// Chunks are written straight into a pre-sized shared mapping of the
+// output file (a heap buffer when the output is a pipe or stdout).
+// The result is byte-identical to CipherPlan::encrypt on the whole input,
+// and to CipherPlan::decrypt on its sanitized letters.
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "cipher_plan.hpp"
+#include "../exp3/caesar_stream.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Chunks smaller than this are not worth a thread.
+ */
+constexpr size_t CIPHER_FILE_MIN_CHUNK = 1 << 20;
+
+namespace file_detail {
+
+/**
+ * @brief Whole input as one contiguous range: mapped when it is a regular
+ * file, read into memory otherwise (pipes, stdin).
+ */
+class InputBytes {
+public:
+    bool open(const std::string& path, std::string& err) {
+#ifndef _WIN32
+        if (!path.empty() && path != "-") {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) { err = path + ": " + std::strerror(errno); return false; }
+            bool mapped = map_.map(fd);
+            ::close(fd); // the mapping outlives the descriptor
+            if (mapped) {
+                view_ = std::string_view(map_.data(), map_.size());
+                return true;
+            }
+        }
+#endif
+        ChunkedInput in;
+        if (!in.open(path, err)) return false;
+        std::string_view chunk;
+        while (in.next(chunk)) buf_.append(chunk.data(), chunk.size());
+        if (in.failed()) { err = path + ": read failed"; return false; }
+        view_ = buf_;
+        return true;
+    }
+
+    std::string_view view() const { return view_; }
+
+private:
+    MappedFile map_;
+    std::string buf_;
+    std::string_view view_;
+};
+
+/**
+ * @brief Output of a size known up front. Regular files are extended to
+ * that size and mapped shared; anything else collects into memory and is
+ * written out by finish().
+ */
+class OutputBytes {
+public:
+    OutputBytes() = default;
+    OutputBytes(const OutputBytes&) = delete;
+    OutputBytes& operator=(const OutputBytes&) = delete;
+    ~OutputBytes() { unmap(); if (fd_ >= 0) ::close(fd_); }
+
+    bool open(const std::string& path, size_t size, std::string& err) {
+        size_ = size;
+#ifndef _WIN32
+        if (!path.empty() && path != "-") {
+            fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd_ < 0) { err = path + ": " + std::strerror(errno); return false; }
+            struct stat st;
+            if (fstat(fd_, &st) == 0 && S_ISREG(st.st_mode)) {
+                if (size == 0) return true;
+                if (ftruncate(fd_, static_cast<off_t>(size)) != 0) { err = path + ": " + std::strerror(errno); return false; }
+                void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+                if (p == MAP_FAILED) { err = path + ": " + std::strerror(errno); return false; }
+                map_ = static_cast<char*>(p);
+                return true;
+            }
+            ::close(fd_);
+            fd_ = -1;
+        }
+#endif
+        if (!out_.open(path, err)) return false;
+        buf_.assign(size, '\0');
+        return true;
+    }
+
+    char* data() { return map_ ? map_ : &buf_[0]; }
+
+    bool finish(std::string& err) {
+        bool ok = true;
+        if (map_) {
+            ok = unmap();
+        } else if (fd_ < 0) {
+            ok = out_.write(buf_.data(), buf_.size()) && out_.close();
+        }
+        if (fd_ >= 0) {
+            ok = ::close(fd_) == 0 && ok;
+            fd_ = -1;
+        }
+        if (!ok) err = "write failed";
+        return ok;
+    }
+
+private:
+    bool unmap() {
+        bool ok = true;
+#ifndef _WIN32
+        if (map_) ok = munmap(map_, size_) == 0;
+#endif
+        map_ = nullptr;
+        return ok;
+    }
+
+    int fd_ = -1;
+    char* map_ = nullptr;
+    size_t size_ = 0;
+    std::string buf_;
+    ChunkedOutput out_;
+};
+
+/**
+ * @brief True if both paths name the same existing file. The output is
+ * truncated before it is written, which would pull a mapped input out from
+ * under the reader (SIGBUS), so such runs are refused.
+ */
+inline bool same_file(const std::string& in_path, const std::string& out_path) {
+#ifndef _WIN32
+    if (in_path.empty() || in_path == "-" || out_path.empty() || out_path == "-") return false;
+    struct stat a, b;
+    return stat(in_path.c_str(), &a) == 0 && stat(out_path.c_str(), &b) == 0 && a.st_dev == b.st_dev &&
+           a.st_ino == b.st_ino;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Opens in_path for reading, unless out_path is the same file.
+ */
+inline bool open_input(InputBytes& input, const std::string& in_path, const std::string& out_path, std::string& err) {
+    if (same_file(in_path, out_path)) {
+        err = in_path + ": input and output are the same file";
+        return false;
+    }
+    return input.open(in_path, err);
+}
+
+/**
+ * @brief Number of chunks for n bytes (at most one per thread).
+ */
+inline size_t chunk_count(size_t n, unsigned threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    return std::max<size_t>(1, std::min<size_t>(threads, n / CIPHER_FILE_MIN_CHUNK));
+}
+
+/**
+ * @brief fn(i) for i in [0, count), each on its own thread (0 on the caller).
+ */
+template <class F>
+void run_chunks(size_t count, F fn) {
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < count; ++i) threads.emplace_back([&fn, i] { fn(i); });
+    fn(0);
+    for (auto& t : threads) t.join();
+}
+
+inline bool is_letter(char c) { return std::isalpha(static_cast<unsigned char>(c)) != 0; }
+
+/**
+ * @brief Cuts text into chunks on transposition block boundaries of its
+ * letter stream: cut[i] is a byte offset with letters[i] letters before
+ * it, a multiple of b for every cut but the last. Returns the letter count.
+ */
+inline size_t block_aligned_cuts(std::string_view text, size_t b, size_t chunks, std::vector<size_t>& cut,
+                                 std::vector<size_t>& letters) {
+    const size_t n = text.size();
+    cut.assign(chunks + 1, 0);
+    letters.assign(chunks + 1, 0);
+    for (size_t i = 0; i <= chunks; ++i) cut[i] = n / chunks * i + std::min(i, n % chunks);
+
+    // Letters per raw chunk.
+    std::vector<size_t> counts(chunks, 0);
+    run_chunks(chunks, [&](size_t i) {
+        counts[i] = static_cast<size_t>(std::count_if(text.begin() + cut[i], text.begin() + cut[i + 1], is_letter));
+    });
+
+    // Move each cut past just enough letters to land on a block boundary.
+    size_t raw_letters = 0;
+    for (size_t i = 1; i < chunks; ++i) {
+        raw_letters += counts[i - 1];
+        size_t pos = cut[i], before = raw_letters;
+        if (pos < cut[i - 1]) {
+            pos = cut[i - 1];
+            before = letters[i - 1];
+        }
+        for (size_t need = (b - before % b) % b; need > 0 && pos < n; ++pos) {
+            if (is_letter(text[pos])) { ++before; --need; }
+        }
+        cut[i] = pos;
+        letters[i] = before;
+    }
+    raw_letters += counts[chunks - 1];
+    letters[chunks] = raw_letters;
+    return raw_letters;
+}
+
+/**
+ * @brief Letters of raw appended to out, upper-cased (sanitize_text's rule).
+ */
+inline void append_letters(std::string_view raw, std::string& out) {
+    static const auto upper = [] {
+        std::array<char, 256> t{};
+        for (int c = 0; c < 256; ++c) t[c] = std::isalpha(c) ? static_cast<char>(std::toupper(c)) : 0;
+        return t;
+    }();
+    size_t o = out.size();
+    out.resize(o + raw.size());
+    for (char c : raw) {
+        char v = upper[static_cast<unsigned char>(c)];
+        out[o] = v;
+        o += v != 0;
+    }
+    out.resize(o);
+}
+
+/**
+ * @brief Raw bytes sanitized per step of decrypt_file; keeps the letter
+ * buffer in cache instead of copying a whole chunk first.
+ */
+constexpr size_t DECRYPT_BATCH_BYTES = 64 << 10;
+
+} // namespace file_detail
+
+/**
+ * @brief Encrypts in_path into out_path ("" or "-" = stdin/stdout) with
+ * the same result as plan.encrypt() on the whole input.
+ */
+inline bool encrypt_file(const CipherPlan& plan, const std::string& in_path, const std::string& out_path,
+                         unsigned threads, std::string& err) {
+    using namespace file_detail;
+    InputBytes input;
+    if (!open_input(input, in_path, out_path, err)) return false;
+    std::string_view text = input.view();
+    const size_t n = text.size();
+    const size_t b = static_cast<size_t>(std::max(1, plan.block_size()));
+    const size_t chunks = chunk_count(n, threads);
+
+    std::vector<size_t> cut, letters;
+    const size_t raw_letters = block_aligned_cuts(text, b, chunks, cut, letters);
+
+    size_t out_size = plan.block_size() > 0 ? (raw_letters + b - 1) / b * b : raw_letters;
+    OutputBytes output;
+    if (!output.open(out_path, out_size, err)) return false;
+    char* out = output.data();
+    // Only a chunk that ends the letter stream can hold a partial block, so
+    // only it pads; chunks after it are empty.
+    run_chunks(chunks, [&](size_t i) {
+        plan.encrypt_into(text.substr(cut[i], cut[i + 1] - cut[i]), out + letters[i]);
+    });
+    return output.finish(err);
+}
+
+/**
+ * @brief Decrypts in_path into out_path with the same result as
+ * plan.decrypt(sanitize_text(input)): anything but letters (a trailing
+ * newline, spacing) is skipped, and a trailing partial block is completed
+ * with ' ' (padding kept).
+ */
+inline bool decrypt_file(const CipherPlan& plan, const std::string& in_path, const std::string& out_path,
+                         unsigned threads, std::string& err) {
+    using namespace file_detail;
+    InputBytes input;
+    if (!open_input(input, in_path, out_path, err)) return false;
+    std::string_view text = input.view();
+    const size_t b = static_cast<size_t>(std::max(1, plan.block_size()));
+    const size_t chunks = chunk_count(text.size(), threads);
+
+    std::vector<size_t> cut, letters;
+    const size_t total = block_aligned_cuts(text, b, chunks, cut, letters);
+
+    OutputBytes output;
+    if (!output.open(out_path, plan.decrypted_size(total), err)) return false;
+    char* out = output.data();
+    // Sanitize a batch at a time and decrypt the whole blocks gathered so
+    // far; only the last chunk can be left with a partial block.
+    run_chunks(chunks, [&](size_t i) {
+        std::string pending;
+        size_t o = letters[i];
+        for (size_t pos = cut[i]; pos < cut[i + 1]; pos += DECRYPT_BATCH_BYTES) {
+            append_letters(text.substr(pos, std::min(DECRYPT_BATCH_BYTES, cut[i + 1] - pos)), pending);
+            size_t whole = pending.size() - pending.size() % b;
+            plan.decrypt_into(std::string_view(pending).substr(0, whole), out + o);
+            o += whole;
+            pending.erase(0, whole);
+        }
+        if (!pending.empty()) plan.decrypt_into(pending, out + o);
+    });
+    return output.finish(err);
+}
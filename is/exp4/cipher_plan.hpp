@@ -0,0 +1,268 @@
+#pragma once
+// Precompiled substitution + transposition plan for the exp4 product cipher.
+// Built once per (keyword, transposition key); encrypt() fuses sanitizing,
+// substitution, block permutation and 'X' padding into one read and one
+// write of the data, decrypt() fuses the inverse permutation with reverse
+// substitution. Block kernels are templates over the permutation so block
+// sizes 2..8 get unrolled loops and {3,1,4,2} (exp4's default) is fully
+// constant-folded.
+
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "substitution_table.hpp"
+
+namespace plan_detail {
+
+/**
+ * @brief Permutation known entirely at compile time (1-based, like exp4 keys).
+ */
+template <int... Key>
+struct StaticPerm {
+    static constexpr int size = sizeof...(Key);
+    static constexpr int at(int j) {
+        constexpr int k[] = {Key...};
+        return k[j] - 1;
+    }
+};
+
+/**
+ * @brief Block size fixed at compile time, permutation chosen at runtime.
+ */
+template <int B>
+struct FixedSizePerm {
+    static constexpr int size = B;
+    std::array<int, B> k;
+    int at(int j) const { return k[j]; }
+};
+
+/**
+ * @brief Fully runtime permutation (any block size).
+ */
+struct DynamicPerm {
+    int size;
+    const int *k;
+    int at(int j) const { return k[j]; }
+};
+
+template <class P>
+inline int block_size(const P &p) { return p.size; }
+
+/**
+ * @brief Sanitize + substitute + permute + pad. enc maps a byte to its
+ * substituted upper-case letter, or 0 if it is not a letter.
+ * Returns bytes written; out needs room for n + block size.
+ */
+template <class P>
+size_t encrypt_blocks(const P &perm, const unsigned char *enc, const char *in, size_t n, char *out) {
+    const int b = block_size(perm);
+    char stack_block[64];
+    std::vector<char> heap_block;
+    char *block = stack_block;
+    if (b > 64) {
+        heap_block.resize(static_cast<size_t>(b));
+        block = heap_block.data();
+    }
+    char *o = out;
+    int q = 0;
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char v = enc[static_cast<unsigned char>(in[i])];
+        if (!v) continue;
+        block[q] = static_cast<char>(v);
+        if (++q == b) {
+            for (int j = 0; j < b; ++j) o[j] = block[perm.at(j)];
+            o += b;
+            q = 0;
+        }
+    }
+    if (q) {
+        // Padding is appended after substitution, so it stays a plain 'X'.
+        for (int j = q; j < b; ++j) block[j] = 'X';
+        for (int j = 0; j < b; ++j) o[j] = block[perm.at(j)];
+        o += b;
+    }
+    return static_cast<size_t>(o - out);
+}
+
+/**
+ * @brief Inverse permutation + reverse substitution over whole blocks.
+ * A trailing partial block is placed as far as it goes; unfilled slots are
+ * ' ', so out needs room for n rounded up to a whole block.
+ */
+template <class P>
+void decrypt_blocks(const P &perm, const SubstitutionTable &rev, const char *in, size_t n, char *out) {
+    const int b = block_size(perm);
+    size_t full = n - n % static_cast<size_t>(b);
+    for (size_t i = 0; i < full; i += static_cast<size_t>(b)) {
+        for (int j = 0; j < b; ++j) out[i + static_cast<size_t>(perm.at(j))] = rev(in[i + static_cast<size_t>(j)]);
+    }
+    if (full < n) {
+        size_t rest = n - full;
+        for (int j = 0; j < b; ++j) out[full + static_cast<size_t>(j)] = ' ';
+        for (int j = 0; j < b && static_cast<size_t>(j) < rest; ++j) {
+            out[full + static_cast<size_t>(perm.at(j))] = rev(in[full + static_cast<size_t>(j)]);
+        }
+    }
+}
+
+} // namespace plan_detail
+
+/**
+ * @brief Reusable fused cipher for one (keyword, transposition key) pair.
+ */
+class CipherPlan {
+public:
+    CipherPlan(const std::string& keyword, const std::vector<int>& transposition_key)
+        : key_(transposition_key) {
+        auto tables = generate_substitution_key(keyword);
+        sub_ = tables.first;
+        rev_ = tables.second;
+        for (int c = 0; c < 256; ++c) {
+            enc_[c] = std::isalpha(c) ? static_cast<unsigned char>(sub_(static_cast<char>(std::toupper(c)))) : 0;
+        }
+        for (int& k : key_) k -= 1; // 0-based from here on
+        select_kernels();
+    }
+
+    int block_size() const { return static_cast<int>(key_.size()); }
+    const SubstitutionTable& forward_table() const { return sub_; }
+    const SubstitutionTable& reverse_table() const { return rev_; }
+
+    /**
+     * @brief Continuous ciphertext for arbitrary plaintext (letters only, padded).
+     */
+    std::string encrypt(std::string_view plaintext) const {
+        std::string out;
+        encrypt_into(plaintext, out);
+        return out;
+    }
+
+    /**
+     * @brief As encrypt(), into out (resized; its capacity is reused across calls).
+     */
+    void encrypt_into(std::string_view plaintext, std::string& out) const {
+        out.resize(plaintext.size() + key_.size());
+        out.resize(encrypt_into(plaintext, &out[0]));
+    }
+
+    /**
+     * @brief As encrypt(), into caller memory of at least size() + block_size() bytes.
+     * @return bytes written.
+     */
+    size_t encrypt_into(std::string_view plaintext, char* out) const {
+        if (key_.empty()) {
+            // No transposition: sanitize + substitute only, like transpose_encrypt's early return.
+            size_t o = 0;
+            for (char c : plaintext) {
+                unsigned char v = enc_[static_cast<unsigned char>(c)];
+                if (v) out[o++] = static_cast<char>(v);
+            }
+            return o;
+        }
+        return encrypt_fn_(*this, plaintext.data(), plaintext.size(), out);
+    }
+
+    /**
+     * @brief Decrypts continuous ciphertext; result keeps the padding.
+     */
+    std::string decrypt(std::string_view ciphertext) const {
+        std::string out;
+        decrypt_into(ciphertext, out);
+        return out;
+    }
+
+    /**
+     * @brief Length of decrypt() for n ciphertext bytes: n rounded up to a
+     * whole block (a trailing partial block is completed with ' ').
+     */
+    size_t decrypted_size(size_t n) const {
+        const size_t b = key_.size();
+        return b ? (n + b - 1) / b * b : n;
+    }
+
+    /**
+     * @brief As decrypt(), into out (resized to decrypted_size(), like
+     * transpose_decrypt_into; its capacity is reused across calls).
+     */
+    void decrypt_into(std::string_view ciphertext, std::string& out) const {
+        out.resize(decrypted_size(ciphertext.size()));
+        decrypt_into(ciphertext, &out[0]);
+    }
+
+    /**
+     * @brief As decrypt(), into caller memory of decrypted_size(ciphertext.size())
+     * bytes (more than ciphertext.size() when it ends in a partial block).
+     */
+    void decrypt_into(std::string_view ciphertext, char* out) const {
+        if (key_.empty()) {
+            substitute(rev_, ciphertext.data(), out, ciphertext.size());
+            return;
+        }
+        decrypt_fn_(*this, ciphertext.data(), ciphertext.size(), out);
+    }
+
+private:
+    using EncryptFn = size_t (*)(const CipherPlan&, const char*, size_t, char*);
+    using DecryptFn = void (*)(const CipherPlan&, const char*, size_t, char*);
+
+    template <int... Key>
+    static size_t enc_static(const CipherPlan& p, const char* in, size_t n, char* out) {
+        return plan_detail::encrypt_blocks(plan_detail::StaticPerm<Key...>{}, p.enc_, in, n, out);
+    }
+    template <int... Key>
+    static void dec_static(const CipherPlan& p, const char* in, size_t n, char* out) {
+        plan_detail::decrypt_blocks(plan_detail::StaticPerm<Key...>{}, p.rev_, in, n, out);
+    }
+
+    template <int B>
+    static plan_detail::FixedSizePerm<B> fixed(const CipherPlan& p) {
+        plan_detail::FixedSizePerm<B> perm;
+        for (int j = 0; j < B; ++j) perm.k[j] = p.key_[j];
+        return perm;
+    }
+    template <int B>
+    static size_t enc_fixed(const CipherPlan& p, const char* in, size_t n, char* out) {
+        return plan_detail::encrypt_blocks(fixed<B>(p), p.enc_, in, n, out);
+    }
+    template <int B>
+    static void dec_fixed(const CipherPlan& p, const char* in, size_t n, char* out) {
+        plan_detail::decrypt_blocks(fixed<B>(p), p.rev_, in, n, out);
+    }
+
+    static size_t enc_dynamic(const CipherPlan& p, const char* in, size_t n, char* out) {
+        return plan_detail::encrypt_blocks(plan_detail::DynamicPerm{p.block_size(), p.key_.data()}, p.enc_, in, n, out);
+    }
+    static void dec_dynamic(const CipherPlan& p, const char* in, size_t n, char* out) {
+        plan_detail::decrypt_blocks(plan_detail::DynamicPerm{p.block_size(), p.key_.data()}, p.rev_, in, n, out);
+    }
+
+    void select_kernels() {
+        if (key_ == std::vector<int>{2, 0, 3, 1}) {
+            encrypt_fn_ = &enc_static<3, 1, 4, 2>;
+            decrypt_fn_ = &dec_static<3, 1, 4, 2>;
+            return;
+        }
+        switch (key_.size()) {
+            case 2: encrypt_fn_ = &enc_fixed<2>; decrypt_fn_ = &dec_fixed<2>; return;
+            case 3: encrypt_fn_ = &enc_fixed<3>; decrypt_fn_ = &dec_fixed<3>; return;
+            case 4: encrypt_fn_ = &enc_fixed<4>; decrypt_fn_ = &dec_fixed<4>; return;
+            case 5: encrypt_fn_ = &enc_fixed<5>; decrypt_fn_ = &dec_fixed<5>; return;
+            case 6: encrypt_fn_ = &enc_fixed<6>; decrypt_fn_ = &dec_fixed<6>; return;
+            case 7: encrypt_fn_ = &enc_fixed<7>; decrypt_fn_ = &dec_fixed<7>; return;
+            case 8: encrypt_fn_ = &enc_fixed<8>; decrypt_fn_ = &dec_fixed<8>; return;
+            default: encrypt_fn_ = &enc_dynamic; decrypt_fn_ = &dec_dynamic; return;
+        }
+    }
+
+    std::vector<int> key_;
+    SubstitutionTable sub_;
+    SubstitutionTable rev_;
+    unsigned char enc_[256];
+    EncryptFn encrypt_fn_ = nullptr;
+    DecryptFn decrypt_fn_ = nullptr;
+};
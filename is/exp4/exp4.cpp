@@ -1,23 +1,26 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include <map>
 #include <set>
 #include <algorithm>
 #include <cctype>
+#include <cstdlib>
+#include "../exp3/cli_args.hpp"
+#include "substitution_table.hpp"
+#include "exp4_stages.hpp"
+#include "cipher_plan.hpp"
+#include "cipher_file.hpp"
+#include "text_layout.hpp"
 
 // --- Forward Declarations ---
-void print_map(const std::map<char, char>& m);
-std::pair<std::map<char, char>, std::map<char, char>> generate_substitution_key(std::string keyword);
-std::pair<std::string, std::string> sanitize_text_keep_original(const std::string& plaintext);
-std::string substitution_encrypt(const std::string& text, const std::map<char, char>& key_map);
-std::string substitution_decrypt(const std::string& text, const std::map<char, char>& rev_map);
-std::string transpose_encrypt(std::string text, const std::vector<int>& key);
-std::string transpose_decrypt(const std::string& text, const std::vector<int>& key);
-std::string reinsert_spacing(const std::string& original_text, const std::string& continuous_text);
+void print_map(const SubstitutionTable& m);
+int run_file_mode(int argc, char** argv);
 
 // --- Main Program ---
-int main() {
+int main(int argc, char** argv) {
+    if (argc > 1) return run_file_mode(argc, argv);
+
+
     // Hardcoded transposition key (same as Python example)
     std::vector<int> transposition_key = {3, 1, 4, 2};
     std::string keyword;
@@ -31,26 +34,28 @@ int main() {
 
     // 1. Prepare keys and text
     auto [sub_key, rev_sub_key] = generate_substitution_key(keyword);
-    auto [original_plain, cleaned_plain] = sanitize_text_keep_original(plaintext_input);
+    std::string cleaned_plain = sanitize_text(plaintext_input);
+    TextLayout layout(plaintext_input); // where the spaces and punctuation go back
+    CipherPlan plan(keyword, transposition_key);
 
-    // 2. Encryption (on cleaned text)
+    // 2. Encryption: the plan sanitizes, substitutes, transposes and pads in one pass.
+    // The substitution-only stage is still computed for display.
     std::string substituted = substitution_encrypt(cleaned_plain, sub_key);
-    std::string ciphertext_continuous = transpose_encrypt(substituted, transposition_key);
-    std::string ciphertext_spaced = reinsert_spacing(original_plain, ciphertext_continuous);
+    std::string ciphertext_continuous = plan.encrypt(plaintext_input);
+    std::string ciphertext_spaced = layout.restore(ciphertext_continuous);
 
     // 3. Decryption (on continuous ciphertext)
-    std::string rev_transposed = transpose_decrypt(ciphertext_continuous, transposition_key);
-    std::string decrypted = substitution_decrypt(rev_transposed, rev_sub_key);
+    std::string decrypted = plan.decrypt(ciphertext_continuous);
     
     // 4. Trim decrypted text to original length to remove padding
     std::string decrypted_trimmed = decrypted.substr(0, cleaned_plain.length());
-    std::string decrypted_with_spacing = reinsert_spacing(original_plain, decrypted_trimmed);
+    std::string decrypted_with_spacing = layout.restore(decrypted_trimmed);
 
     // --- Show results ---
     std::cout << "\n--- Results ---\n";
     std::cout << "Generated Substitution Key: ";
     print_map(sub_key);
-    std::cout << "Original Plaintext (as entered):  " << original_plain << std::endl;
+    std::cout << "Original Plaintext (as entered):  " << plaintext_input << std::endl;
     std::cout << "Plaintext used for encryption   :  " << cleaned_plain << std::endl;
     std::cout << "After Substitution (clean)      :  " << substituted << std::endl;
     std::cout << "Ciphertext (continuous)         :  " << ciphertext_continuous << std::endl;
@@ -65,145 +70,90 @@ int main() {
 // --- Function Implementations ---
 
 /**
- * @brief Generates substitution and reverse-substitution maps from a keyword.
+ * @brief Parses a transposition key such as "3,1,4,2".
  */
-std::pair<std::map<char, char>, std::map<char, char>> generate_substitution_key(std::string keyword) {
-    std::string cipher_alphabet = "";
-    std::set<char> seen;
-
-    std::transform(keyword.begin(), keyword.end(), keyword.begin(), ::toupper);
-    for (char ch : keyword) {
-        if (std::isalpha(ch) && seen.find(ch) == seen.end()) {
-            cipher_alphabet += ch;
-            seen.insert(ch);
-        }
-    }
-
-    for (char ch = 'A'; ch <= 'Z'; ++ch) {
-        if (seen.find(ch) == seen.end()) {
-            cipher_alphabet += ch;
-        }
+static bool parse_transposition_key(const std::string& s, std::vector<int>& key) {
+    key.clear();
+    size_t pos = 0;
+    while (pos < s.size()) {
+        size_t comma = s.find(',', pos);
+        std::string part = s.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        if (part.empty() || part.find_first_not_of("0123456789") != std::string::npos) return false;
+        key.push_back(std::stoi(part));
+        if (comma == std::string::npos) break;
+        pos = comma + 1;
     }
-
-    std::map<char, char> sub_key;
-    std::map<char, char> rev_sub_key;
-    char plain_char = 'A';
-    for (char cipher_char : cipher_alphabet) {
-        sub_key[plain_char] = cipher_char;
-        rev_sub_key[cipher_char] = plain_char;
-        plain_char++;
+    std::vector<int> sorted = key;
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        if (sorted[i] != static_cast<int>(i) + 1) return false; // must be a permutation of 1..n
     }
-
-    return {sub_key, rev_sub_key};
+    return true;
 }
 
-/**
- * @brief Cleans plaintext to keep only uppercase letters, but also returns the original.
- */
-std::pair<std::string, std::string> sanitize_text_keep_original(const std::string& plaintext) {
-    std::string cleaned = "";
-    for (char ch : plaintext) {
-        if (std::isalpha(ch)) {
-            cleaned += std::toupper(ch);
-        }
-    }
-    return {plaintext, cleaned};
+static void print_usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " --encrypt|--decrypt --keyword WORD [--key 3,1,4,2]\n"
+              << "        [--in FILE] [--out FILE] [--threads N]\n"
+              << "  With no arguments runs the interactive demo.\n"
+              << "  --encrypt   letters of the input -> continuous padded ciphertext\n"
+              << "  --decrypt   letters of the ciphertext -> plaintext (padding kept)\n"
+              << "  --key       transposition key (default 3,1,4,2)\n"
+              << "  --in/--out  files (default/-: stdin/stdout); regular files are mapped\n"
+              << "              and processed in block-aligned chunks on all cores\n"
+              << "  --threads N threads (default: all cores)\n";
 }
 
 /**
- * @brief Encrypts/decrypts text using a given substitution map.
+ * @brief Whole-file encrypt/decrypt: exp4 --encrypt --keyword K --in F --out G.
  */
-std::string substitution_encrypt(const std::string& text, const std::map<char, char>& key_map) {
-    std::string result = "";
-    for (char ch : text) {
-        // .count checks if the key exists in the map
-        if (key_map.count(ch)) {
-            result += key_map.at(ch);
-        } else {
-            result += ch; // Append character as-is if not in map (e.g., padding)
-        }
-    }
-    return result;
-}
-
-std::string substitution_decrypt(const std::string& text, const std::map<char, char>& rev_map) {
-    return substitution_encrypt(text, rev_map); // The logic is identical, just uses a different map
-}
-
-/**
- * @brief Encrypts text using a columnar transposition cipher.
- */
-std::string transpose_encrypt(std::string text, const std::vector<int>& key) {
-    int block_size = key.size();
-    if (block_size == 0) return text;
-    
-    int padding = (block_size - (text.length() % block_size)) % block_size;
-    text.append(padding, 'X');
-
-    std::string result = "";
-    for (size_t i = 0; i < text.length(); i += block_size) {
-        std::string block = text.substr(i, block_size);
-        for (int j = 0; j < block_size; ++j) {
-            // Key is 1-based, so subtract 1 for 0-based C++ indexing
-            result += block[key[j] - 1];
-        }
-    }
-    return result;
-}
-
-/**
- * @brief Decrypts text from a columnar transposition cipher.
- */
-std::string transpose_decrypt(const std::string& text, const std::vector<int>& key) {
-    int block_size = key.size();
-    if (block_size == 0) return text;
-
-    std::string result = "";
-    for (size_t i = 0; i < text.length(); i += block_size) {
-        std::string block = text.substr(i, block_size);
-        std::string temp(block_size, ' ');
-        for (int j = 0; j < block_size; ++j) {
-            // Key is 1-based, so subtract 1
-            temp[key[j] - 1] = block[j];
+int run_file_mode(int argc, char** argv) {
+    std::string keyword, in_path, out_path;
+    std::vector<int> transposition_key = {3, 1, 4, 2};
+    int mode = 0; // 1 encrypt, 2 decrypt
+    unsigned threads = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--encrypt") mode = 1;
+        else if (arg == "--decrypt") mode = 2;
+        else if (arg == "--keyword" && has_value) keyword = argv[++i];
+        else if (arg == "--in" && has_value) in_path = argv[++i];
+        else if (arg == "--out" && has_value) out_path = argv[++i];
+        else if (arg == "--threads" && has_value) {
+            if (!parseIntArg(argv[++i], 0, MAX_THREADS_ARG, threads)) {
+                std::cerr << "Error: --threads must be a number from 0 to " << MAX_THREADS_ARG << "\n";
+                return 2;
+            }
         }
-        result += temp;
-    }
-    return result;
-}
-
-/**
- * @brief Reinserts spaces and punctuation from an original text into a continuous text.
- */
-std::string reinsert_spacing(const std::string& original_text, const std::string& continuous_text) {
-    std::string result = "";
-    auto continuous_iter = continuous_text.begin();
-    
-    for (char original_char : original_text) {
-        if (std::isalpha(original_char)) {
-            if (continuous_iter != continuous_text.end()) {
-                result += *continuous_iter;
-                ++continuous_iter;
-            } else {
-                result += 'X'; // Fallback if continuous text is shorter
+        else if (arg == "--key" && has_value) {
+            if (!parse_transposition_key(argv[++i], transposition_key)) {
+                std::cerr << "Error: --key must be a permutation of 1..n, e.g. 3,1,4,2\n";
+                return 2;
             }
-        } else {
-            result += original_char; // Preserve space/punctuation
         }
+        else { print_usage(argv[0]); return 2; }
+    }
+    if (mode == 0 || keyword.empty()) { print_usage(argv[0]); return 2; }
+
+    CipherPlan plan(keyword, transposition_key);
+    std::string err;
+    bool ok = mode == 1 ? encrypt_file(plan, in_path, out_path, threads, err)
+                        : decrypt_file(plan, in_path, out_path, threads, err);
+    if (!ok) {
+        std::cerr << "Error: " << err << std::endl;
+        return 1;
     }
-    // Append any leftover characters from continuous text (i.e., padding)
-    result.append(continuous_iter, continuous_text.end());
-    return result;
+    return 0;
 }
 
 /**
- * @brief Helper function to print a map for verification.
+ * @brief Helper function to print the A..Z part of a table for verification.
  */
-void print_map(const std::map<char, char>& m) {
+void print_map(const SubstitutionTable& m) {
     std::cout << "{";
-    auto it = m.begin();
-    while (it != m.end()) {
-        std::cout << "'" << it->first << "': '" << it->second << "'";
-        if (++it != m.end()) {
+    for (char ch = 'A'; ch <= 'Z'; ++ch) {
+        std::cout << "'" << ch << "': '" << m(ch) << "'";
+        if (ch != 'Z') {
             std::cout << ", ";
         }
     }
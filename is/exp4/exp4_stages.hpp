@@ -0,0 +1,215 @@
+#pragma once
+// Stage-by-stage exp4 product cipher: sanitize, substitute, transpose and
+// spacing restoration as separate passes. exp4 shows every intermediate
+// stage; CipherPlan is the fused equivalent of the cipher part.
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "substitution_table.hpp"
+
+/**
+ * @brief Cleans plaintext to keep only uppercase letters, into out.
+ * Every stage has an *_into form like this one: out is resized and
+ * overwritten, and keeps its capacity, so a caller transforming many
+ * messages reuses one buffer. out must not overlap the input.
+ */
+inline void sanitize_text_into(std::string_view plaintext, std::string& out) {
+    out.resize(plaintext.size());
+    size_t n = 0;
+    for (char ch : plaintext) {
+        if (std::isalpha(static_cast<unsigned char>(ch))) out[n++] = static_cast<char>(std::toupper(static_cast<unsigned char>(ch)));
+    }
+    out.resize(n);
+}
+
+/**
+ * @brief Cleans plaintext to keep only uppercase letters.
+ */
+inline std::string sanitize_text(const std::string& plaintext) {
+    std::string cleaned;
+    sanitize_text_into(plaintext, cleaned);
+    return cleaned;
+}
+
+/**
+ * @brief Cleans plaintext to keep only uppercase letters, but also returns the original.
+ * TextLayout (text_layout.hpp) keeps what reinsert_spacing needs in far less memory.
+ */
+inline std::pair<std::string, std::string> sanitize_text_keep_original(const std::string& plaintext) {
+    return {plaintext, sanitize_text(plaintext)};
+}
+
+/**
+ * @brief Substitutes text into out with a given substitution table.
+ * Bytes outside A..Z (e.g. padding) map to themselves.
+ */
+inline void substitution_encrypt_into(std::string_view text, const SubstitutionTable& key_map, std::string& out) {
+    out.resize(text.size());
+    substitute(key_map, text.data(), &out[0], text.size());
+}
+
+/**
+ * @brief Substitutes text in place (decrypting is the same with the reverse table).
+ */
+inline void substitute_in_place(std::string& text, const SubstitutionTable& key_map) {
+    substitute(key_map, text.data(), &text[0], text.size());
+}
+
+/**
+ * @brief Encrypts/decrypts text using a given substitution table.
+ * Bytes outside A..Z (e.g. padding) map to themselves.
+ */
+inline std::string substitution_encrypt(const std::string& text, const SubstitutionTable& key_map) {
+    std::string result;
+    substitution_encrypt_into(text, key_map, result);
+    return result;
+}
+
+inline std::string substitution_decrypt(const std::string& text, const SubstitutionTable& rev_map) {
+    return substitution_encrypt(text, rev_map); // The logic is identical, just uses a different map
+}
+
+/**
+ * @brief Columnar transposition into out: each block of key.size() letters
+ * is rearranged so slot j holds block[key[j] - 1] (key is 1-based). The last
+ * block is padded with 'X'.
+ */
+inline void transpose_encrypt_into(std::string_view text, const std::vector<int>& key, std::string& out) {
+    const size_t b = key.size();
+    if (b == 0) {
+        out.assign(text.data(), text.size());
+        return;
+    }
+    const size_t n = text.size();
+    out.resize((n + b - 1) / b * b);
+    const size_t full = n - n % b;
+    for (size_t i = 0; i < full; i += b) {
+        for (size_t j = 0; j < b; ++j) out[i + j] = text[i + static_cast<size_t>(key[j] - 1)];
+    }
+    for (size_t j = 0; full < n && j < b; ++j) {
+        size_t src = full + static_cast<size_t>(key[j] - 1);
+        out[full + j] = src < n ? text[src] : 'X';
+    }
+}
+
+/**
+ * @brief Inverse of transpose_encrypt_into. A trailing partial block is
+ * placed as far as it goes and the rest of that block is ' '.
+ */
+inline void transpose_decrypt_into(std::string_view text, const std::vector<int>& key, std::string& out) {
+    const size_t b = key.size();
+    if (b == 0) {
+        out.assign(text.data(), text.size());
+        return;
+    }
+    const size_t n = text.size();
+    out.resize((n + b - 1) / b * b);
+    const size_t full = n - n % b;
+    for (size_t i = 0; i < full; i += b) {
+        for (size_t j = 0; j < b; ++j) out[i + static_cast<size_t>(key[j] - 1)] = text[i + j];
+    }
+    if (full < n) {
+        std::fill(out.begin() + static_cast<std::ptrdiff_t>(full), out.end(), ' ');
+        for (size_t j = 0; full + j < n; ++j) out[full + static_cast<size_t>(key[j] - 1)] = text[full + j];
+    }
+}
+
+namespace stages_detail {
+
+/**
+ * @brief Block-by-block permutation of text in place through a block-sized
+ * scratch copy; encrypt gathers (slot j <- key[j]), decrypt scatters.
+ */
+inline void transpose_blocks_in_place(std::string& text, const std::vector<int>& key, bool encrypt) {
+    const size_t b = key.size();
+    char stack_block[64];
+    std::vector<char> heap_block(b > sizeof(stack_block) ? b : 0);
+    char* block = b > sizeof(stack_block) ? heap_block.data() : stack_block;
+    for (size_t i = 0; i < text.size(); i += b) {
+        std::copy(text.begin() + static_cast<std::ptrdiff_t>(i), text.begin() + static_cast<std::ptrdiff_t>(i + b), block);
+        for (size_t j = 0; j < b; ++j) {
+            size_t k = static_cast<size_t>(key[j] - 1);
+            if (encrypt) text[i + j] = block[k];
+            else text[i + k] = block[j];
+        }
+    }
+}
+
+} // namespace stages_detail
+
+/**
+ * @brief transpose_encrypt_into on text's own bytes ('X' padding appended).
+ */
+inline void transpose_encrypt_in_place(std::string& text, const std::vector<int>& key) {
+    if (key.empty()) return;
+    text.append((key.size() - text.size() % key.size()) % key.size(), 'X');
+    stages_detail::transpose_blocks_in_place(text, key, true);
+}
+
+/**
+ * @brief transpose_decrypt_into on text's own bytes. A trailing partial
+ * block is handled as there, so text may grow to whole blocks.
+ */
+inline void transpose_decrypt_in_place(std::string& text, const std::vector<int>& key) {
+    const size_t b = key.size();
+    if (b == 0) return;
+    const size_t n = text.size(), full = n - n % b;
+    if (full < n) {
+        // Spread the partial block to its slots first; only whole blocks are left for the loop.
+        std::string tail;
+        transpose_decrypt_into(std::string_view(text).substr(full), key, tail);
+        text.resize(full);
+        stages_detail::transpose_blocks_in_place(text, key, false);
+        text += tail;
+        return;
+    }
+    stages_detail::transpose_blocks_in_place(text, key, false);
+}
+
+/**
+ * @brief Encrypts text using a columnar transposition cipher.
+ */
+inline std::string transpose_encrypt(const std::string& text, const std::vector<int>& key) {
+    std::string result;
+    transpose_encrypt_into(text, key, result);
+    return result;
+}
+
+/**
+ * @brief Decrypts text from a columnar transposition cipher.
+ */
+inline std::string transpose_decrypt(const std::string& text, const std::vector<int>& key) {
+    std::string result;
+    transpose_decrypt_into(text, key, result);
+    return result;
+}
+
+/**
+ * @brief Reinserts spaces and punctuation from an original text into a continuous text.
+ */
+inline std::string reinsert_spacing(const std::string& original_text, const std::string& continuous_text) {
+    std::string result = "";
+    auto continuous_iter = continuous_text.begin();
+    
+    for (char original_char : original_text) {
+        if (std::isalpha(original_char)) {
+            if (continuous_iter != continuous_text.end()) {
+                result += *continuous_iter;
+                ++continuous_iter;
+            } else {
+                result += 'X'; // Fallback if continuous text is shorter
+            }
+        } else {
+            result += original_char; // Preserve space/punctuation
+        }
+    }
+    // Append any leftover characters from continuous text (i.e., padding)
+    result.append(continuous_iter, continuous_text.end());
+    return result;
+}
@@ -0,0 +1,394 @@
+#pragma once
+// Dictionary attack on the exp4 product cipher: every dictionary word as
+// the substitution keyword, combined with every transposition key of
+// block size 2..8 (every permutation of 1..b).
+//
+// Candidates are never materialized. Keywords are reduced to the part of
+// their alphabet that differs from A..Z and sorted, so consecutive
+// keywords share a prefix and the key schedule only redoes the letters
+// after it. The (keyword, permutation) space is cut into chunks of a
+// keyword range times a permutation range; threads claim chunks from one
+// atomic counter and unrank their permutations on the spot. Each
+// candidate decrypts a short ciphertext prefix and sums trigram
+// log-probabilities, giving up as soon as the running score falls below
+// an English-like level; survivors are rescored on a longer stretch.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../exp3/ngram_model.hpp"
+
+using TrigramModel = NgramModel<3>;
+
+/**
+ * @brief Largest transposition block size keyword_attack() tries: 12!
+ * permutations per keyword is already far beyond any time budget.
+ */
+constexpr int KEYWORD_ATTACK_MAX_BLOCK = 12;
+
+/**
+ * @brief Tuning knobs for keyword_attack().
+ */
+struct KeywordAttackOptions {
+    unsigned threads = 0;          // 0 = all hardware threads
+    int min_block = 2;
+    int max_block = 8;
+    size_t prefix_letters = 32;    // letters decrypted for the early-rejection test
+    size_t rescore_letters = 512;  // letters scored for candidates that pass it
+    double reject_margin = 0.4;    // 0 = reject below English average .. 1 = below random text
+    size_t top = 5;                // candidates kept
+    double time_limit_seconds = 0; // 0 = no limit
+};
+
+/**
+ * @brief A (keyword, transposition key) pair and how English it decrypts.
+ */
+struct KeywordCandidate {
+    std::string keyword;
+    std::vector<int> transposition_key; // 1-based, as exp4 takes it
+    double score = -1e300;              // trigram log10 probability per trigram
+};
+
+/**
+ * @brief Outcome of keyword_attack(): best candidates first, plus counters.
+ */
+struct KeywordAttackResult {
+    std::vector<KeywordCandidate> best;
+    uint64_t candidates = 0;  // (keyword, permutation) pairs tried
+    uint64_t survivors = 0;   // passed the prefix test
+    size_t alphabets = 0;     // distinct keyword alphabets
+    double seconds = 0.0;
+    bool timed_out = false;
+
+    double candidates_per_second() const { return seconds > 0 ? static_cast<double>(candidates) / seconds : 0.0; }
+};
+
+namespace attack_detail {
+
+/**
+ * @brief Keyword letters in first-occurrence order, minus the tail that
+ * generate_substitution_key would produce anyway ("AB" and "A" both give
+ * the plain alphabet), so equal alphabets have equal keys. Upper-case,
+ * letters only.
+ */
+inline std::string keyword_key(std::string_view word) {
+    std::string key;
+    uint32_t seen = 0;
+    for (char ch : word) {
+        int c = (ch | 0x20) - 'a';
+        if (c < 0 || c > 25 || (seen >> c & 1)) continue;
+        seen |= 1u << c;
+        key += static_cast<char>('A' + c);
+    }
+    while (!key.empty()) {
+        uint32_t before = seen & ~(1u << (key.back() - 'A'));
+        if (key.back() - 'A' != __builtin_ctz(~before)) break;
+        seen = before;
+        key.pop_back();
+    }
+    return key;
+}
+
+/**
+ * @brief Distinct keyword alphabets, sorted by key so neighbours share
+ * prefixes; words[i] is the first (shortest) word that gives keys[i].
+ */
+struct KeywordSet {
+    std::vector<std::string> keys;
+    std::vector<std::string> words;
+};
+
+inline KeywordSet build_keyword_set(const std::vector<std::string>& words) {
+    std::vector<std::pair<std::string, std::string>> pairs;
+    pairs.reserve(words.size());
+    for (const std::string& w : words) pairs.emplace_back(keyword_key(w), w);
+    std::sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b) {
+        if (a.first != b.first) return a.first < b.first;
+        if (a.second.size() != b.second.size()) return a.second.size() < b.second.size();
+        return a.second < b.second;
+    });
+    KeywordSet set;
+    for (auto& p : pairs) {
+        if (!set.keys.empty() && set.keys.back() == p.first) continue;
+        set.keys.push_back(std::move(p.first));
+        set.words.push_back(std::move(p.second));
+    }
+    return set;
+}
+
+/**
+ * @brief Incremental key schedule: rev[cipher letter] = plain letter for
+ * the alphabet of keys[i], reusing the letters shared with the previous
+ * key and filling the rest from the unused-letter mask.
+ */
+class KeySchedule {
+public:
+    const std::array<uint8_t, 26>& set(const std::string& key) {
+        size_t common = 0;
+        while (common < depth_ && common < key.size() && key[common] == prev_[common]) ++common;
+        for (size_t i = common; i < key.size(); ++i) {
+            int c = key[i] - 'A';
+            seen_[i + 1] = seen_[i] | 1u << c;
+            rev_[c] = static_cast<uint8_t>(i);
+            prev_[i] = key[i];
+        }
+        depth_ = key.size();
+        uint8_t plain = static_cast<uint8_t>(depth_);
+        for (uint32_t rest = ~seen_[depth_] & ((1u << 26) - 1); rest; rest &= rest - 1) {
+            rev_[__builtin_ctz(rest)] = plain++;
+        }
+        return rev_;
+    }
+
+private:
+    std::array<uint8_t, 26> rev_{};
+    std::array<uint32_t, 27> seen_{};
+    std::array<char, 26> prev_{};
+    size_t depth_ = 0;
+};
+
+/**
+ * @brief The r-th permutation (lexicographic) of 0..b-1.
+ */
+inline void unrank_permutation(uint64_t r, int b, int* out) {
+    int pool[16];
+    uint64_t fact = 1;
+    for (int i = 0; i < b; ++i) {
+        pool[i] = i;
+        if (i > 0) fact *= static_cast<uint64_t>(i);
+    }
+    for (int i = 0; i < b; ++i) {
+        uint64_t d = r / fact;
+        r %= fact;
+        out[i] = pool[d];
+        for (int j = static_cast<int>(d); j + 1 < b - i; ++j) pool[j] = pool[j + 1];
+        if (b - 1 - i > 0) fact /= static_cast<uint64_t>(b - 1 - i);
+    }
+}
+
+inline uint64_t factorial(int n) {
+    uint64_t f = 1;
+    for (int i = 2; i <= n; ++i) f *= static_cast<uint64_t>(i);
+    return f;
+}
+
+/**
+ * @brief First n cipher letters (0..25) put back in plaintext order for
+ * transposition key perm (0-based: output slot j holds block[perm[j]]).
+ */
+inline void untranspose(const uint8_t* cipher, size_t n, const int* perm, int b, uint8_t* out) {
+    for (size_t i = 0; i + static_cast<size_t>(b) <= n; i += static_cast<size_t>(b)) {
+        for (int j = 0; j < b; ++j) out[i + static_cast<size_t>(perm[j])] = cipher[i + static_cast<size_t>(j)];
+    }
+}
+
+/**
+ * @brief Trigram log-probability sum of rev-mapped letters u[0, n).
+ */
+inline double trigram_score(const float* tri, const uint8_t* u, size_t n, const std::array<uint8_t, 26>& rev) {
+    if (n < 3) return 0.0;
+    size_t idx = static_cast<size_t>(rev[u[0]]) * 26 + rev[u[1]];
+    double s = 0.0;
+    for (size_t i = 2; i < n; ++i) {
+        idx = (idx * 26 + rev[u[i]]) % 17576;
+        s += tri[idx];
+    }
+    return s;
+}
+
+// Trigrams scored before the first rejection check, and between checks.
+constexpr size_t ATTACK_FIRST_CHECK = 8;
+constexpr size_t ATTACK_CHECK_EVERY = 4;
+
+/**
+ * @brief trigram_score with early exit: false as soon as the running sum
+ * trails reject_per_trigram per trigram at a checkpoint.
+ */
+inline bool trigram_prefix_passes(const float* tri, const uint8_t* u, size_t n, const std::array<uint8_t, 26>& rev,
+                                  double reject_per_trigram) {
+    if (n < 3) return true;
+    size_t idx = static_cast<size_t>(rev[u[0]]) * 26 + rev[u[1]];
+    double s = 0.0;
+    for (size_t i = 2; i < n; ++i) {
+        idx = (idx * 26 + rev[u[i]]) % 17576;
+        s += tri[idx];
+        size_t scored = i - 1;
+        if (scored >= ATTACK_FIRST_CHECK && (scored - ATTACK_FIRST_CHECK) % ATTACK_CHECK_EVERY == 0 &&
+            s < reject_per_trigram * static_cast<double>(scored)) {
+            return false;
+        }
+    }
+    return s >= reject_per_trigram * static_cast<double>(n - 2);
+}
+
+/**
+ * @brief Plain English prose that is not part of the model's training
+ * data, so its score is what a correct decryption can actually reach.
+ */
+constexpr std::string_view ENGLISH_REFERENCE_TEXT =
+    "When the river rose in the spring the families who lived along the lower road would carry their "
+    "furniture up to the church on the hill and wait there until the water went down again. Nobody "
+    "remembered a year when it had not happened, and most of them had stopped complaining about it long "
+    "ago. The children liked it best, because school was closed for a week and there was always somebody "
+    "with a boat who would take them out over the flooded fields to look at the roofs of the barns.";
+
+/**
+ * @brief Mean trigram log-probability of held-out English
+ * (ENGLISH_REFERENCE_TEXT) and of uniformly random letters.
+ */
+inline std::pair<double, double> trigram_reference_levels(const TrigramModel& m) {
+    std::vector<uint8_t> u;
+    for (char ch : ENGLISH_REFERENCE_TEXT) {
+        int c = (ch | 0x20) - 'a';
+        if (c >= 0 && c <= 25) u.push_back(static_cast<uint8_t>(c));
+    }
+    std::array<uint8_t, 26> id;
+    for (int i = 0; i < 26; ++i) id[i] = static_cast<uint8_t>(i);
+    double english = trigram_score(m.table(), u.data(), u.size(), id) / static_cast<double>(u.size() - 2);
+    double random = 0.0;
+    for (size_t i = 0; i < TrigramModel::TABLE_SIZE; ++i) random += m.logp(i);
+    return {english, random / static_cast<double>(TrigramModel::TABLE_SIZE)};
+}
+
+/**
+ * @brief Best-first list of at most `cap` candidates.
+ */
+inline void keep_best(std::vector<KeywordCandidate>& best, KeywordCandidate c, size_t cap) {
+    auto pos = std::find_if(best.begin(), best.end(), [&](const KeywordCandidate& o) { return c.score > o.score; });
+    if (static_cast<size_t>(pos - best.begin()) >= cap) return;
+    best.insert(pos, std::move(c));
+    if (best.size() > cap) best.pop_back();
+}
+
+} // namespace attack_detail
+
+/**
+ * @brief Block sizes in opts.min_block..opts.max_block (at most
+ * KEYWORD_ATTACK_MAX_BLOCK) that divide the number of ciphertext letters:
+ * exp4 output is always whole blocks. Empty if none does.
+ */
+inline std::vector<int> keyword_attack_block_sizes(size_t letters, const KeywordAttackOptions& opts) {
+    std::vector<int> sizes;
+    for (int b = std::max(1, opts.min_block); b <= std::min(opts.max_block, KEYWORD_ATTACK_MAX_BLOCK); ++b) {
+        if (letters > 0 && letters % static_cast<size_t>(b) == 0) sizes.push_back(b);
+    }
+    return sizes;
+}
+
+/**
+ * @brief Tries every keyword from words with every transposition key of
+ * opts.min_block..opts.max_block whose block size divides the ciphertext
+ * length. cipher is continuous exp4 ciphertext (non-letters are ignored).
+ */
+inline KeywordAttackResult keyword_attack(std::string_view cipher, const std::vector<std::string>& words,
+                                          const TrigramModel& model, const KeywordAttackOptions& opts = {}) {
+    using namespace attack_detail;
+    auto start = std::chrono::steady_clock::now();
+    KeywordAttackResult result;
+
+    std::vector<uint8_t> text;
+    for (char ch : cipher) {
+        int c = (ch | 0x20) - 'a';
+        if (c >= 0 && c <= 25) text.push_back(static_cast<uint8_t>(c));
+    }
+    std::vector<int> sizes = keyword_attack_block_sizes(text.size(), opts);
+    KeywordSet keywords = build_keyword_set(words);
+    result.alphabets = keywords.keys.size();
+    if (keywords.keys.empty() || text.size() < 3) return result;
+
+    // Chunks: [keyword range] x [permutation range] per block size.
+    const size_t KEYWORDS_PER_CHUNK = 256;
+    const uint64_t PERMS_PER_CHUNK = 256;
+    struct Span {
+        int b;
+        uint64_t perm_chunks, first_chunk;
+    };
+    std::vector<Span> spans;
+    const uint64_t keyword_chunks = (keywords.keys.size() + KEYWORDS_PER_CHUNK - 1) / KEYWORDS_PER_CHUNK;
+    uint64_t total_chunks = 0;
+    for (int b : sizes) {
+        uint64_t perm_chunks = (factorial(b) + PERMS_PER_CHUNK - 1) / PERMS_PER_CHUNK;
+        spans.push_back(Span{b, perm_chunks, total_chunks});
+        total_chunks += perm_chunks * keyword_chunks;
+    }
+
+    auto levels = trigram_reference_levels(model);
+    const double reject = levels.first - opts.reject_margin * (levels.first - levels.second);
+    const float* tri = model.table();
+
+    std::atomic<uint64_t> next_chunk{0}, candidates{0}, survivors{0};
+    std::atomic<bool> stop{false};
+    std::mutex best_mutex;
+    unsigned threads = opts.threads ? opts.threads : std::max(1u, std::thread::hardware_concurrency());
+
+    auto worker = [&]() {
+        KeySchedule schedule;
+        std::vector<KeywordCandidate> local;
+        std::vector<uint8_t> prefixes, longer(std::min(text.size(), std::max(opts.rescore_letters, size_t{3})));
+        uint64_t tried = 0, passed = 0;
+        int perm[16];
+        for (uint64_t chunk; !stop.load(std::memory_order_relaxed) && (chunk = next_chunk.fetch_add(1)) < total_chunks;) {
+            const Span& span = *std::prev(std::upper_bound(spans.begin(), spans.end(), chunk,
+                                                           [](uint64_t c, const Span& s) { return c < s.first_chunk; }));
+            const int b = span.b;
+            uint64_t local_chunk = chunk - span.first_chunk;
+            uint64_t p0 = local_chunk % span.perm_chunks * PERMS_PER_CHUNK;
+            uint64_t p1 = std::min(factorial(b), p0 + PERMS_PER_CHUNK);
+            size_t k0 = static_cast<size_t>(local_chunk / span.perm_chunks) * KEYWORDS_PER_CHUNK;
+            size_t k1 = std::min(keywords.keys.size(), k0 + KEYWORDS_PER_CHUNK);
+
+            // This chunk's permutations applied to the ciphertext prefix.
+            size_t plen = std::min(text.size(), (opts.prefix_letters + static_cast<size_t>(b) - 1) / static_cast<size_t>(b) * static_cast<size_t>(b));
+            prefixes.resize(static_cast<size_t>(p1 - p0) * plen);
+            for (uint64_t p = p0; p < p1; ++p) {
+                unrank_permutation(p, b, perm);
+                untranspose(text.data(), plen, perm, b, prefixes.data() + (p - p0) * plen);
+            }
+
+            for (size_t k = k0; k < k1; ++k) {
+                const std::array<uint8_t, 26>& rev = schedule.set(keywords.keys[k]);
+                for (uint64_t p = p0; p < p1; ++p) {
+                    ++tried;
+                    if (!trigram_prefix_passes(tri, prefixes.data() + (p - p0) * plen, plen, rev, reject)) continue;
+                    ++passed;
+                    unrank_permutation(p, b, perm);
+                    size_t llen = longer.size() / static_cast<size_t>(b) * static_cast<size_t>(b);
+                    untranspose(text.data(), llen, perm, b, longer.data());
+                    KeywordCandidate c;
+                    c.score = trigram_score(tri, longer.data(), llen, rev) / static_cast<double>(llen - 2);
+                    if (local.size() >= opts.top && c.score <= local.back().score) continue;
+                    c.keyword = keywords.words[k];
+                    for (int j = 0; j < b; ++j) c.transposition_key.push_back(perm[j] + 1);
+                    keep_best(local, std::move(c), opts.top);
+                }
+            }
+            if (opts.time_limit_seconds > 0 &&
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > opts.time_limit_seconds) {
+                stop.store(true);
+            }
+        }
+        candidates.fetch_add(tried);
+        survivors.fetch_add(passed);
+        std::lock_guard<std::mutex> lk(best_mutex);
+        for (KeywordCandidate& c : local) keep_best(result.best, std::move(c), opts.top);
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+
+    result.candidates = candidates.load();
+    result.survivors = survivors.load();
+    result.timed_out = stop.load();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
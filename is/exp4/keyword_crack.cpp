@@ -0,0 +1,147 @@
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+#include "../exp3/cli_args.hpp"
+#include "cipher_plan.hpp"
+#include "exp4_stages.hpp"
+#include "keyword_attack.hpp"
+
+// --- Forward Declarations ---
+void print_usage(const char* prog);
+bool read_ciphertext(const std::string& path, std::string& out);
+
+/**
+ * @brief Recovers the keyword and transposition key of an exp4 ciphertext
+ * by trying every SCOWL word with every permutation of block size 2..8.
+ *
+ *   keyword_crack [--in FILE] [--scowl DIR] [--max-level N] [--threads N]
+ *                 [--min-block B] [--max-block B] [--prefix N] [--margin M]
+ *                 [--top N] [--time SECONDS]
+ *
+ * Without --in, one line of continuous ciphertext is read from stdin.
+ */
+int main(int argc, char** argv) {
+    std::string in_path;
+    std::string scowl_dir = "../exp3/scowl-2020.12.07/final";
+    int max_level = 35;
+    KeywordAttackOptions opts;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << "\n";
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        auto int_value = [&](long long lo, long long hi, auto& out) {
+            std::string v = value();
+            if (!parseIntArg(v.c_str(), lo, hi, out)) {
+                std::cerr << "Invalid value for " << arg << ": " << v << "\n";
+                print_usage(argv[0]);
+                std::exit(2);
+            }
+        };
+        if (arg == "--in") in_path = value();
+        else if (arg == "--scowl") scowl_dir = value();
+        else if (arg == "--max-level") int_value(0, 100, max_level);
+        else if (arg == "--threads") int_value(0, MAX_THREADS_ARG, opts.threads);
+        else if (arg == "--min-block") int_value(1, KEYWORD_ATTACK_MAX_BLOCK, opts.min_block);
+        else if (arg == "--max-block") int_value(1, std::numeric_limits<int>::max(), opts.max_block);
+        else if (arg == "--prefix") int_value(1, 1 << 20, opts.prefix_letters);
+        else if (arg == "--margin") opts.reject_margin = std::atof(value().c_str());
+        else if (arg == "--top") int_value(1, 1 << 20, opts.top);
+        else if (arg == "--time") opts.time_limit_seconds = std::atof(value().c_str());
+        else if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (opts.max_block > KEYWORD_ATTACK_MAX_BLOCK) {
+        std::cerr << "--max-block " << opts.max_block << " is too large: block sizes above " << KEYWORD_ATTACK_MAX_BLOCK
+                  << " are not tried (" << KEYWORD_ATTACK_MAX_BLOCK << "! keys per keyword already)\n";
+        return 2;
+    }
+    if (opts.min_block > opts.max_block) {
+        std::cerr << "--min-block " << opts.min_block << " is larger than --max-block " << opts.max_block << "\n";
+        return 2;
+    }
+
+    std::string ciphertext;
+    if (in_path.empty()) {
+        std::cout << "Enter ciphertext: ";
+        std::getline(std::cin, ciphertext);
+    } else if (!read_ciphertext(in_path, ciphertext)) {
+        std::cerr << "Cannot read " << in_path << "\n";
+        return 1;
+    }
+
+    size_t letters = sanitize_text(ciphertext).size();
+    if (keyword_attack_block_sizes(letters, opts).empty()) {
+        std::cerr << "No block size in " << opts.min_block << ".." << opts.max_block << " divides the " << letters
+                  << " ciphertext letters; exp4 ciphertext is always whole blocks (see --min-block/--max-block)\n";
+        return 1;
+    }
+
+    ScowlIndex dict = buildScowlIndex(listScowlFiles(scowl_dir, max_level, SCOWL_WORDS));
+    std::vector<std::string> keywords;
+    dict.forEach([&](std::string_view w, ScowlEntry) { keywords.emplace_back(w); });
+    TrigramModel model;
+    if (keywords.empty() || !trainNgramModelFromIndex(model, dict, max_level)) {
+        std::cerr << "No SCOWL word lists found in " << scowl_dir << " (use --scowl DIR)\n";
+        return 1;
+    }
+
+    KeywordAttackResult res = keyword_attack(ciphertext, keywords, model, opts);
+
+    std::cout << "\n--- Results ---\n";
+    std::cout << "Keywords / distinct alphabets   :  " << keywords.size() << " / " << res.alphabets << std::endl;
+    std::cout << "Candidates tried                :  " << res.candidates << (res.timed_out ? " (time limit hit)" : "")
+              << std::endl;
+    std::cout << "Passed prefix test              :  " << res.survivors << std::endl;
+    std::cout << "Seconds / candidates per second :  " << std::fixed << std::setprecision(3) << res.seconds << " / "
+              << std::setprecision(0) << res.candidates_per_second() << std::endl;
+    for (size_t i = 0; i < res.best.size(); ++i) {
+        const KeywordCandidate& c = res.best[i];
+        std::string key;
+        for (int k : c.transposition_key) key += (key.empty() ? "" : ",") + std::to_string(k);
+        std::string plain = CipherPlan(c.keyword, c.transposition_key).decrypt(sanitize_text(ciphertext));
+        if (plain.size() > 60) plain = plain.substr(0, 60) + "...";
+        std::cout << "#" << i + 1 << " keyword " << std::left << std::setw(14) << c.keyword << " key " << std::setw(16)
+                  << key << std::right << " score " << std::setprecision(3) << c.score << "  " << plain << std::endl;
+    }
+    return res.best.empty() ? 1 : 0;
+}
+
+// --- Function Implementations ---
+
+void print_usage(const char* prog) {
+    std::cerr << "Usage: " << prog
+              << " [--in FILE] [--scowl DIR] [--max-level N] [--threads N] [--min-block B] [--max-block B]\n"
+              << "        [--prefix N] [--margin M] [--top N] [--time SECONDS]\n"
+              << "  --max-level N  SCOWL size level of the keyword list (default 35)\n"
+              << "  --min-block/--max-block  transposition block sizes tried (default 2..8, at most 12)\n"
+              << "  --prefix N     letters decrypted per candidate before rejecting it (default 32)\n"
+              << "  --margin M     rejection level from English (0) to random text (1) (default 0.4)\n";
+}
+
+/**
+ * @brief Reads a whole file into out.
+ */
+bool read_ciphertext(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
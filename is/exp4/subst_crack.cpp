@@ -0,0 +1,110 @@
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include "../exp3/cli_args.hpp"
+#include "subst_solver.hpp"
+
+// --- Forward Declarations ---
+void print_usage(const char* prog);
+bool read_ciphertext(const std::string& path, std::string& out);
+
+/**
+ * @brief Cracks a keyword/monoalphabetic substitution ciphertext (the
+ * substitution stage of exp4) by quadgram hill climbing.
+ *
+ *   subst_crack [--in FILE] [--scowl DIR] [--max-level N] [--threads N]
+ *               [--restarts N] [--letters N] [--time SECONDS]
+ *
+ * Without --in, one line of ciphertext is read from stdin.
+ */
+int main(int argc, char** argv) {
+    std::string in_path;
+    std::string scowl_dir = "../exp3/scowl-2020.12.07/final";
+    int max_level = 70;
+    SubstSolverOptions opts;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << "\n";
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        auto int_value = [&](long long lo, long long hi, auto& out) {
+            std::string v = value();
+            if (!parseIntArg(v.c_str(), lo, hi, out)) {
+                std::cerr << "Invalid value for " << arg << ": " << v << "\n";
+                print_usage(argv[0]);
+                std::exit(2);
+            }
+        };
+        if (arg == "--in") in_path = value();
+        else if (arg == "--scowl") scowl_dir = value();
+        else if (arg == "--max-level") int_value(0, 100, max_level);
+        else if (arg == "--threads") int_value(0, MAX_THREADS_ARG, opts.threads);
+        else if (arg == "--restarts") int_value(1, 1 << 20, opts.max_restarts);
+        else if (arg == "--letters") int_value(0, 1ll << 40, opts.max_letters);
+        else if (arg == "--time") opts.time_limit_seconds = std::atof(value().c_str());
+        else if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::string ciphertext;
+    if (in_path.empty()) {
+        std::cout << "Enter ciphertext: ";
+        std::getline(std::cin, ciphertext);
+    } else if (!read_ciphertext(in_path, ciphertext)) {
+        std::cerr << "Cannot read " << in_path << "\n";
+        return 1;
+    }
+
+    QuadgramModel model;
+    if (!trainNgramModelFromScowl(model, scowl_dir, max_level)) {
+        std::cerr << "No SCOWL word lists found in " << scowl_dir << " (use --scowl DIR)\n";
+        return 1;
+    }
+
+    SubstSolution sol = solve_substitution(ciphertext, model, opts);
+
+    std::cout << "\n--- Results ---\n";
+    std::cout << "Recovered Substitution Key: ";
+    std::string alpha = sol.cipher_alphabet();
+    for (int i = 0; i < 26; ++i) std::cout << static_cast<char>('A' + i) << "->" << alpha[i] << " ";
+    std::cout << std::endl;
+    std::cout << "Cipher alphabet                 :  " << alpha << std::endl;
+    std::cout << "Fitness (log10)                 :  " << std::fixed << std::setprecision(2) << sol.fitness << std::endl;
+    std::cout << "Restarts / seconds              :  " << sol.restarts << " / " << std::setprecision(3) << sol.seconds << std::endl;
+    std::cout << "Decrypted                       :  " << sol.decrypt(ciphertext) << std::endl;
+    return 0;
+}
+
+// --- Function Implementations ---
+
+void print_usage(const char* prog) {
+    std::cerr << "Usage: " << prog
+              << " [--in FILE] [--scowl DIR] [--max-level N] [--threads N] [--restarts N] [--letters N]\n"
+              << "        [--time SECONDS]\n"
+              << "  --letters N  letters the key is fitted to (default 4000, 0 = all); the whole\n"
+              << "               input is then decrypted with it\n";
+}
+
+/**
+ * @brief Reads a whole file into out.
+ */
+bool read_ciphertext(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
@@ -0,0 +1,239 @@
+#pragma once
+// Quadgram hill-climbing / simulated-annealing solver for general
+// monoalphabetic substitution (e.g. keyword alphabets from
+// generate_substitution_key).
+//
+// The key is a decryption permutation dec[cipher] = plain over 0..25.
+// Fitness is the sum of quadgram log-probabilities of the decryption.
+// Swapping dec[a] and dec[b] only changes quadgrams that contain cipher
+// letter a or b, so each step rescores just those positions (precomputed
+// per letter pair) instead of the whole text. Restarts run on every core
+// and publish into one shared best. Only the first max_letters letters are
+// solved on: the pair tables grow with the text (every pair holds the
+// positions of both its letters) and a few thousand letters already pin
+// the key down; the key then decrypts the whole input.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "../exp3/ngram_model.hpp"
+
+using QuadgramModel = NgramModel<4>;
+
+/**
+ * @brief Tuning knobs for solve_substitution().
+ */
+struct SubstSolverOptions {
+    unsigned threads = 0;          // 0 = all hardware threads
+    int max_restarts = 200;        // total across threads
+    int stall_restarts = 24;       // stop once this many restarts in a row fail to improve
+    int iterations = 6000;         // annealing steps per restart
+    size_t max_letters = 4000;     // letters of the ciphertext the key is fitted to (0 = all)
+    double start_temperature = 6.0;
+    double time_limit_seconds = 5.0;
+    uint64_t seed = 0x5eed;
+};
+
+/**
+ * @brief Best decryption found.
+ */
+struct SubstSolution {
+    std::array<uint8_t, 26> dec{}; // cipher letter -> plain letter
+    double fitness = -1e300;       // over the letters solved on
+    int restarts = 0;              // restarts that ran to completion
+    double seconds = 0.0;
+
+    /**
+     * @brief Encryption alphabet (plain A..Z -> cipher), as generate_substitution_key prints it.
+     */
+    std::string cipher_alphabet() const {
+        std::string alpha(26, '?');
+        for (int c = 0; c < 26; ++c) alpha[dec[c]] = static_cast<char>('A' + c);
+        return alpha;
+    }
+
+    /**
+     * @brief Apply the key to text; letters keep their case, everything else is copied.
+     */
+    std::string decrypt(std::string_view text) const {
+        std::string out(text);
+        for (char& ch : out) {
+            if (ch >= 'A' && ch <= 'Z') ch = static_cast<char>('A' + dec[ch - 'A']);
+            else if (ch >= 'a' && ch <= 'z') ch = static_cast<char>('a' + dec[ch - 'a']);
+        }
+        return out;
+    }
+};
+
+namespace subst_detail {
+
+/**
+ * @brief Ciphertext reduced to letter indices plus, per cipher letter pair,
+ * the quadgram start positions that touch either letter.
+ */
+struct Workspace {
+    std::vector<uint8_t> text;
+    std::vector<uint32_t> positions[26][26]; // [a][b] with a < b
+    std::array<int, 26> freq{};
+
+    Workspace(std::string_view cipher, size_t max_letters) {
+        for (char ch : cipher) {
+            if (max_letters && text.size() == max_letters) break;
+            int c = (ch | 0x20) - 'a';
+            if (c >= 0 && c < 26) text.push_back(static_cast<uint8_t>(c));
+        }
+        if (text.size() < 4) return;
+        std::vector<uint32_t> per_letter[26];
+        for (size_t p = 0; p + 4 <= text.size(); ++p) {
+            uint32_t seen = 0;
+            for (int k = 0; k < 4; ++k) seen |= 1u << text[p + k];
+            for (uint32_t m = seen; m; m &= m - 1) per_letter[__builtin_ctz(m)].push_back(static_cast<uint32_t>(p));
+        }
+        for (uint8_t c : text) freq[c]++;
+        for (int a = 0; a < 26; ++a) {
+            for (int b = a + 1; b < 26; ++b) {
+                auto& dst = positions[a][b];
+                std::set_union(per_letter[a].begin(), per_letter[a].end(),
+                               per_letter[b].begin(), per_letter[b].end(), std::back_inserter(dst));
+            }
+        }
+    }
+};
+
+inline double quad_at(const QuadgramModel& m, const std::vector<uint8_t>& t, const uint8_t* dec, size_t p) {
+    size_t idx = ((static_cast<size_t>(dec[t[p]]) * 26 + dec[t[p + 1]]) * 26 + dec[t[p + 2]]) * 26 + dec[t[p + 3]];
+    return m.logp(idx);
+}
+
+inline double full_fitness(const QuadgramModel& m, const Workspace& w, const uint8_t* dec) {
+    double s = 0.0;
+    for (size_t p = 0; p + 4 <= w.text.size(); ++p) s += quad_at(m, w.text, dec, p);
+    return s;
+}
+
+/**
+ * @brief Start from frequency order with some random swaps so restarts differ.
+ */
+inline void initial_key(const Workspace& w, std::mt19937_64& rng, uint8_t* dec, int restart) {
+    static const char ENGLISH_ORDER[] = "ETAOINSHRDLCUMWFGYPBVKJXQZ";
+    std::array<int, 26> order;
+    for (int i = 0; i < 26; ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return w.freq[a] > w.freq[b]; });
+    for (int i = 0; i < 26; ++i) dec[order[i]] = static_cast<uint8_t>(ENGLISH_ORDER[i] - 'A');
+    int perturb = restart == 0 ? 0 : 4 + restart % 20;
+    for (int i = 0; i < perturb; ++i) std::swap(dec[rng() % 26], dec[rng() % 26]);
+}
+
+} // namespace subst_detail
+
+/**
+ * @brief Recover a substitution key for cipher using the quadgram model.
+ */
+inline SubstSolution solve_substitution(std::string_view cipher, const QuadgramModel& model,
+                                        const SubstSolverOptions& opts = {}) {
+    using namespace subst_detail;
+    auto start = std::chrono::steady_clock::now();
+    Workspace ws(cipher, opts.max_letters);
+    SubstSolution best;
+    for (int i = 0; i < 26; ++i) best.dec[i] = static_cast<uint8_t>(i);
+    if (ws.text.size() < 4) return best;
+
+    unsigned threads = opts.threads ? opts.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::mutex best_mutex;
+    std::atomic<int> restarts{0};   // handed out (one past the last by the time workers exit)
+    std::atomic<int> completed{0};
+    std::atomic<int> stall{0};
+    std::atomic<bool> stop{false};
+
+    auto worker = [&](unsigned tid) {
+        std::mt19937_64 rng(opts.seed + tid * 0x9e3779b97f4a7c15ull);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        std::array<uint8_t, 26> dec;
+        for (;;) {
+            int r = restarts.fetch_add(1);
+            if (r >= opts.max_restarts || stop.load()) break;
+            initial_key(ws, rng, dec.data(), r);
+            double fit = full_fitness(model, ws, dec.data());
+            double local_best = fit;
+            std::array<uint8_t, 26> local_dec = dec;
+
+            for (int it = 0; it < opts.iterations; ++it) {
+                double temp = opts.start_temperature * (1.0 - static_cast<double>(it) / opts.iterations);
+                int a = static_cast<int>(rng() % 26), b = static_cast<int>(rng() % 25);
+                if (b >= a) ++b;
+                if (a > b) std::swap(a, b);
+                const auto& pos = ws.positions[a][b];
+                if (pos.empty()) continue;
+                double before = 0.0, after = 0.0;
+                for (uint32_t p : pos) before += quad_at(model, ws.text, dec.data(), p);
+                std::swap(dec[a], dec[b]);
+                for (uint32_t p : pos) after += quad_at(model, ws.text, dec.data(), p);
+                double delta = after - before;
+                if (delta >= 0.0 || (temp > 0.0 && unit(rng) < std::exp(delta / temp))) {
+                    fit += delta;
+                    if (fit > local_best) {
+                        local_best = fit;
+                        local_dec = dec;
+                    }
+                } else {
+                    std::swap(dec[a], dec[b]);
+                }
+            }
+            // Finish with a greedy pass over every pair from the best state.
+            dec = local_dec;
+            fit = local_best;
+            for (bool improved = true; improved;) {
+                improved = false;
+                for (int a = 0; a < 26; ++a) {
+                    for (int b = a + 1; b < 26; ++b) {
+                        const auto& pos = ws.positions[a][b];
+                        if (pos.empty()) continue;
+                        double before = 0.0, after = 0.0;
+                        for (uint32_t p : pos) before += quad_at(model, ws.text, dec.data(), p);
+                        std::swap(dec[a], dec[b]);
+                        for (uint32_t p : pos) after += quad_at(model, ws.text, dec.data(), p);
+                        if (after > before + 1e-9) {
+                            fit += after - before;
+                            improved = true;
+                        } else {
+                            std::swap(dec[a], dec[b]);
+                        }
+                    }
+                }
+            }
+
+            completed.fetch_add(1);
+            {
+                std::lock_guard<std::mutex> lk(best_mutex);
+                if (fit > best.fitness + 1e-6) {
+                    best.fitness = fit;
+                    best.dec = dec;
+                    stall.store(0);
+                } else if (stall.fetch_add(1) + 1 >= opts.stall_restarts) {
+                    stop.store(true);
+                }
+            }
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (elapsed > opts.time_limit_seconds) stop.store(true);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker, t);
+    worker(0);
+    for (auto& t : pool) t.join();
+
+    best.restarts = completed.load();
+    best.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return best;
+}
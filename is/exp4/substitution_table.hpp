@@ -0,0 +1,177 @@
+#pragma once
+// Flat lookup-table substitution for the exp4 product cipher.
+// A SubstitutionTable maps every byte; only 'A'..'Z' are ever remapped, so
+// padding and anything else passes through unchanged. Bulk substitution
+// uses a nibble shuffle (pshufb): two 16-entry lookups cover the 26
+// letters, and a range mask keeps every other byte as it was.
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <utility>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SUBSTITUTION_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief 256-entry byte map plus the 26 letter images packed for SIMD.
+ */
+struct SubstitutionTable {
+    std::array<unsigned char, 256> lut;
+    alignas(32) unsigned char letters[32]; // image of 'A' + i for i < 26, rest unused
+
+    SubstitutionTable() {
+        for (int i = 0; i < 256; ++i) lut[i] = static_cast<unsigned char>(i);
+        for (int i = 0; i < 32; ++i) letters[i] = static_cast<unsigned char>('A' + (i < 26 ? i : 0));
+    }
+
+    void set(char plain, char cipher) {
+        lut[static_cast<unsigned char>(plain)] = static_cast<unsigned char>(cipher);
+        letters[plain - 'A'] = static_cast<unsigned char>(cipher);
+    }
+
+    char operator()(char c) const { return static_cast<char>(lut[static_cast<unsigned char>(c)]); }
+};
+
+inline void substitute_scalar(const SubstitutionTable &t, const char *in, char *out, size_t n) {
+    for (size_t i = 0; i < n; ++i) out[i] = t(in[i]);
+}
+
+#ifdef SUBSTITUTION_KERNEL_X86
+
+__attribute__((target("ssse3")))
+inline size_t substitute_ssse3(const SubstitutionTable &t, const char *in, char *out, size_t n) {
+    const __m128i lo = _mm_load_si128(reinterpret_cast<const __m128i *>(t.letters));
+    const __m128i hi = _mm_load_si128(reinterpret_cast<const __m128i *>(t.letters + 16));
+    const __m128i base = _mm_set1_epi8('A');
+    const __m128i maxIdx = _mm_set1_epi8(25);
+    const __m128i sixteen = _mm_set1_epi8(16);
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        __m128i idx = _mm_sub_epi8(c, base);
+        __m128i letter = _mm_cmpeq_epi8(_mm_min_epu8(idx, maxIdx), idx);
+        __m128i upper = _mm_cmpeq_epi8(_mm_max_epu8(idx, sixteen), idx);
+        __m128i low4 = _mm_and_si128(idx, nibble);
+        __m128i a = _mm_shuffle_epi8(lo, low4);
+        __m128i b = _mm_shuffle_epi8(hi, low4);
+        __m128i sub = _mm_or_si128(_mm_and_si128(upper, b), _mm_andnot_si128(upper, a));
+        c = _mm_or_si128(_mm_and_si128(letter, sub), _mm_andnot_si128(letter, c));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), c);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+inline size_t substitute_avx2(const SubstitutionTable &t, const char *in, char *out, size_t n) {
+    // vpshufb looks up within each 128-bit lane, so broadcast both halves.
+    const __m256i lo = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(t.letters)));
+    const __m256i hi = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i *>(t.letters + 16)));
+    const __m256i base = _mm256_set1_epi8('A');
+    const __m256i maxIdx = _mm256_set1_epi8(25);
+    const __m256i sixteen = _mm256_set1_epi8(16);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+        __m256i idx = _mm256_sub_epi8(c, base);
+        __m256i letter = _mm256_cmpeq_epi8(_mm256_min_epu8(idx, maxIdx), idx);
+        __m256i upper = _mm256_cmpeq_epi8(_mm256_max_epu8(idx, sixteen), idx);
+        __m256i low4 = _mm256_and_si256(idx, nibble);
+        __m256i sub = _mm256_blendv_epi8(_mm256_shuffle_epi8(lo, low4), _mm256_shuffle_epi8(hi, low4), upper);
+        c = _mm256_blendv_epi8(c, sub, letter);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), c);
+    }
+    return i;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline size_t substitute_avx512(const SubstitutionTable &t, const char *in, char *out, size_t n) {
+    const __m512i lo = _mm512_maskz_broadcast_i32x4(0xffff, _mm_load_si128(reinterpret_cast<const __m128i *>(t.letters)));
+    const __m512i hi = _mm512_maskz_broadcast_i32x4(0xffff, _mm_load_si128(reinterpret_cast<const __m128i *>(t.letters + 16)));
+    const __m512i base = _mm512_set1_epi8('A');
+    const __m512i maxIdx = _mm512_set1_epi8(25);
+    const __m512i sixteen = _mm512_set1_epi8(16);
+    const __m512i nibble = _mm512_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i c = _mm512_loadu_si512(in + i);
+        __m512i idx = _mm512_sub_epi8(c, base);
+        __mmask64 letter = _mm512_cmple_epu8_mask(idx, maxIdx);
+        __mmask64 upper = _mm512_cmpge_epu8_mask(idx, sixteen);
+        __m512i low4 = _mm512_and_si512(idx, nibble);
+        __m512i sub = _mm512_mask_blend_epi8(upper, _mm512_shuffle_epi8(lo, low4), _mm512_shuffle_epi8(hi, low4));
+        c = _mm512_mask_blend_epi8(letter, c, sub);
+        _mm512_storeu_si512(out + i, c);
+    }
+    return i;
+}
+
+#endif // SUBSTITUTION_KERNEL_X86
+
+using SubstituteFn = size_t (*)(const SubstitutionTable &, const char *, char *, size_t);
+
+/**
+ * @brief Widest substitution kernel this CPU supports, resolved once.
+ */
+inline SubstituteFn substitution_kernel() {
+    static const SubstituteFn fn = [] () -> SubstituteFn {
+#ifdef SUBSTITUTION_KERNEL_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512bw")) return &substitute_avx512;
+        if (__builtin_cpu_supports("avx2")) return &substitute_avx2;
+        if (__builtin_cpu_supports("ssse3")) return &substitute_ssse3;
+#endif
+        return nullptr;
+    }();
+    return fn;
+}
+
+/**
+ * @brief Substitutes n bytes from in into out (in == out is fine).
+ */
+inline void substitute(const SubstitutionTable &t, const char *in, char *out, size_t n) {
+    SubstituteFn fn = substitution_kernel();
+    size_t done = fn ? fn(t, in, out, n) : 0;
+    substitute_scalar(t, in + done, out + done, n - done);
+}
+
+/**
+ * @brief Generates substitution and reverse-substitution tables from a keyword.
+ */
+inline std::pair<SubstitutionTable, SubstitutionTable> generate_substitution_key(std::string keyword) {
+    std::string cipher_alphabet = "";
+    std::set<char> seen;
+
+    std::transform(keyword.begin(), keyword.end(), keyword.begin(), ::toupper);
+    for (char ch : keyword) {
+        if (std::isalpha(ch) && seen.find(ch) == seen.end()) {
+            cipher_alphabet += ch;
+            seen.insert(ch);
+        }
+    }
+
+    for (char ch = 'A'; ch <= 'Z'; ++ch) {
+        if (seen.find(ch) == seen.end()) {
+            cipher_alphabet += ch;
+        }
+    }
+
+    SubstitutionTable sub_key;
+    SubstitutionTable rev_sub_key;
+    char plain_char = 'A';
+    for (char cipher_char : cipher_alphabet) {
+        sub_key.set(plain_char, cipher_char);
+        rev_sub_key.set(cipher_char, plain_char);
+        plain_char++;
+    }
+
+    return {sub_key, rev_sub_key};
+}
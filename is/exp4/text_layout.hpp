@@ -0,0 +1,345 @@
+#pragma once
+// Format preservation for exp4 without keeping the original text.
+// TextLayout records where the letters were (one bit per input byte) and
+// what the other bytes were, run-length encoded in order. For English
+// prose that is about 1/8 of the input plus two bytes per punctuation
+// mark: nearly every non-letter is a space, so the gaps between
+// punctuation collapse into one run each.
+// Classification is one SIMD compare + movemask pass. Restoring the
+// spacing scatters the continuous cipher stream through the mask: the
+// gap bytes of each 4 KiB chunk are expanded from their runs first, then
+// every 64-byte word of output is two expand-loads (AVX-512 VBMI2) or
+// eight pshufb lookups (SSSE3) that merge letters and gaps.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TEXT_LAYOUT_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+namespace layout_detail {
+
+inline bool is_ascii_letter(unsigned char c) { return static_cast<unsigned char>((c | 0x20) - 'a') <= 25; }
+
+/**
+ * @brief Sets bit i of mask (zeroed, one word per 64 bytes) for every
+ * letter in p[begin, n).
+ */
+inline void classify_scalar(const char* p, size_t begin, size_t n, uint64_t* mask) {
+    for (size_t i = begin; i < n; ++i) {
+        if (is_ascii_letter(static_cast<unsigned char>(p[i]))) mask[i / 64] |= uint64_t{1} << (i % 64);
+    }
+}
+
+/**
+ * @brief Scalar scatter of one mask word's first `bytes` positions.
+ */
+inline void expand_word_scalar(uint64_t m, size_t bytes, const char* letters, size_t& li, const char* gaps,
+                               size_t& gi, char* out) {
+    for (size_t j = 0; j < bytes; ++j) out[j] = (m >> j) & 1 ? letters[li++] : gaps[gi++];
+}
+
+#ifdef TEXT_LAYOUT_KERNEL_X86
+
+// Each classifier fills whole mask words and returns the bytes it covered.
+
+__attribute__((target("sse2")))
+inline size_t classify_sse2(const char* p, size_t n, uint64_t* mask) {
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i a = _mm_set1_epi8('a');
+    const __m128i max_idx = _mm_set1_epi8(25);
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        uint64_t m = 0;
+        for (int k = 0; k < 4; ++k) {
+            __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 16 * k));
+            __m128i idx = _mm_sub_epi8(_mm_or_si128(c, lower), a);
+            __m128i letter = _mm_cmpeq_epi8(_mm_min_epu8(idx, max_idx), idx);
+            m |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(letter))) << (16 * k);
+        }
+        mask[i / 64] = m;
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+inline size_t classify_avx2(const char* p, size_t n, uint64_t* mask) {
+    const __m256i lower = _mm256_set1_epi8(0x20);
+    const __m256i a = _mm256_set1_epi8('a');
+    const __m256i max_idx = _mm256_set1_epi8(25);
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m256i c0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i c1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 32));
+        __m256i i0 = _mm256_sub_epi8(_mm256_or_si256(c0, lower), a);
+        __m256i i1 = _mm256_sub_epi8(_mm256_or_si256(c1, lower), a);
+        uint32_t lo = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(i0, max_idx), i0)));
+        uint32_t hi = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(i1, max_idx), i1)));
+        mask[i / 64] = lo | static_cast<uint64_t>(hi) << 32;
+    }
+    return i;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline size_t classify_avx512(const char* p, size_t n, uint64_t* mask) {
+    const __m512i lower = _mm512_set1_epi8(0x20);
+    const __m512i a = _mm512_set1_epi8('a');
+    const __m512i max_idx = _mm512_set1_epi8(25);
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i idx = _mm512_sub_epi8(_mm512_or_si512(_mm512_loadu_si512(p + i), lower), a);
+        mask[i / 64] = _mm512_cmple_epu8_mask(idx, max_idx);
+    }
+    return i;
+}
+
+// Each expander writes 64 output bytes per mask word, for as many leading
+// words as it can, and returns how many; li/gi advance past what it used.
+
+using ShuffleTable = std::array<std::array<uint8_t, 16>, 256>;
+
+/**
+ * @brief pshufb control that spreads the low popcount(m) bytes of a
+ * register over the set bits of m (0x80, i.e. zero, elsewhere).
+ */
+inline const ShuffleTable& expand_shuffles() {
+    alignas(16) static const ShuffleTable t = [] {
+        ShuffleTable a{};
+        for (int m = 0; m < 256; ++m) {
+            uint8_t next = 0;
+            for (int j = 0; j < 16; ++j) a[m][j] = j < 8 && (m >> j) & 1 ? next++ : 0x80;
+        }
+        return a;
+    }();
+    return t;
+}
+
+// Reads 8 bytes per group, so it stops while a word could read past the
+// letters it was given; gaps come from a padded buffer.
+__attribute__((target("ssse3,popcnt")))
+inline size_t expand_ssse3(const uint64_t* mask, size_t words, const char* letters, size_t letters_avail,
+                           const char* gaps, char* out, size_t& li, size_t& gi) {
+    const ShuffleTable& shuf = expand_shuffles();
+    size_t w = 0;
+    for (; w < words && li + 72 <= letters_avail; ++w, out += 64) {
+        uint64_t m = mask[w];
+        if (m == ~uint64_t{0}) {
+            std::memcpy(out, letters + li, 64);
+            li += 64;
+            continue;
+        }
+        if (m == 0) {
+            std::memcpy(out, gaps + gi, 64);
+            gi += 64;
+            continue;
+        }
+        for (int k = 0; k < 8; ++k) {
+            unsigned b = static_cast<unsigned>(m >> (8 * k)) & 0xff;
+            __m128i l = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(letters + li));
+            __m128i g = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(gaps + gi));
+            __m128i r = _mm_or_si128(_mm_shuffle_epi8(l, _mm_load_si128(reinterpret_cast<const __m128i*>(shuf[b].data()))),
+                                     _mm_shuffle_epi8(g, _mm_load_si128(reinterpret_cast<const __m128i*>(shuf[b ^ 0xff].data()))));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 8 * k), r);
+            int taken = _mm_popcnt_u32(b);
+            li += static_cast<size_t>(taken);
+            gi += static_cast<size_t>(8 - taken);
+        }
+    }
+    return w;
+}
+
+// Masked expand-loads never touch bytes they do not use.
+__attribute__((target("avx512f,avx512bw,avx512vbmi2,popcnt")))
+inline size_t expand_vbmi2(const uint64_t* mask, size_t words, const char* letters, size_t /*letters_avail*/,
+                           const char* gaps, char* out, size_t& li, size_t& gi) {
+    for (size_t w = 0; w < words; ++w) {
+        __mmask64 m = mask[w];
+        __m512i g = _mm512_maskz_expandloadu_epi8(~m, gaps + gi);
+        _mm512_storeu_si512(out + 64 * w, _mm512_mask_expandloadu_epi8(g, m, letters + li));
+        int taken = static_cast<int>(_mm_popcnt_u64(m));
+        li += static_cast<size_t>(taken);
+        gi += static_cast<size_t>(64 - taken);
+    }
+    return words;
+}
+
+#endif // TEXT_LAYOUT_KERNEL_X86
+
+using ClassifyFn = size_t (*)(const char*, size_t, uint64_t*);
+using ExpandFn = size_t (*)(const uint64_t*, size_t, const char*, size_t, const char*, char*, size_t&, size_t&);
+
+/**
+ * @brief Widest classify/expand pair this CPU supports, resolved once;
+ * nullptr means scalar only.
+ */
+struct LayoutKernel {
+    const char* name;
+    ClassifyFn classify;
+    ExpandFn expand;
+};
+
+inline const LayoutKernel& layout_kernel() {
+    static const LayoutKernel k = [] {
+#ifdef TEXT_LAYOUT_KERNEL_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512vbmi2") && __builtin_cpu_supports("avx512bw"))
+            return LayoutKernel{"avx512vbmi2", &classify_avx512, &expand_vbmi2};
+        if (__builtin_cpu_supports("avx2")) return LayoutKernel{"avx2", &classify_avx2, &expand_ssse3};
+        if (__builtin_cpu_supports("ssse3") && __builtin_cpu_supports("popcnt"))
+            return LayoutKernel{"ssse3", &classify_sse2, &expand_ssse3};
+        if (__builtin_cpu_supports("sse2")) return LayoutKernel{"sse2", &classify_sse2, nullptr};
+#endif
+        return LayoutKernel{"scalar", nullptr, nullptr};
+    }();
+    return k;
+}
+
+} // namespace layout_detail
+
+/**
+ * @brief Letter positions and non-letter bytes of a text, without the text.
+ * A letter is an ASCII letter (std::isalpha in the "C" locale).
+ */
+class TextLayout {
+public:
+    TextLayout() = default;
+
+    explicit TextLayout(std::string_view text) : size_(text.size()), mask_((text.size() + 63) / 64, 0) {
+        using namespace layout_detail;
+        const LayoutKernel& k = layout_kernel();
+        size_t done = k.classify ? k.classify(text.data(), size_, mask_.data()) : 0;
+        classify_scalar(text.data(), done, size_, mask_.data());
+
+        // Gap bytes, visited through the complement of the mask.
+        char run_byte = 0;
+        size_t run_count = 0;
+        for (size_t w = 0; w < mask_.size(); ++w) {
+            letters_ += static_cast<size_t>(__builtin_popcountll(mask_[w]));
+            uint64_t gaps = ~mask_[w];
+            if (w + 1 == mask_.size() && size_ % 64) gaps &= (uint64_t{1} << (size_ % 64)) - 1;
+            for (; gaps; gaps &= gaps - 1) {
+                char c = text[w * 64 + static_cast<size_t>(__builtin_ctzll(gaps))];
+                if (run_count > 0 && c == run_byte) {
+                    ++run_count;
+                    continue;
+                }
+                if (run_count > 0) append_run(run_byte, run_count);
+                run_byte = c;
+                run_count = 1;
+            }
+        }
+        if (run_count > 0) append_run(run_byte, run_count);
+        runs_.shrink_to_fit();
+    }
+
+    size_t size() const { return size_; }
+    size_t letters() const { return letters_; }
+    size_t run_count() const { return run_count_; }
+
+    /**
+     * @brief Heap bytes held (mask words and encoded runs).
+     */
+    size_t memory_bytes() const { return mask_.size() * sizeof(uint64_t) + runs_.size(); }
+
+    /**
+     * @brief Same as reinsert_spacing(original, continuous): letters are
+     * taken from continuous in order ('X' once it runs out), everything
+     * else is put back, and leftover continuous bytes (padding) follow.
+     */
+    std::string restore(std::string_view continuous) const {
+        std::string out(restored_size(continuous.size()), '\0');
+        restore_into(continuous, &out[0]);
+        return out;
+    }
+
+    size_t restored_size(size_t continuous_size) const {
+        return size_ + (continuous_size > letters_ ? continuous_size - letters_ : 0);
+    }
+
+    /**
+     * @brief As restore(), into caller memory of restored_size(continuous.size()) bytes.
+     */
+    void restore_into(std::string_view continuous, char* out) const {
+        using namespace layout_detail;
+        const ExpandFn expand = layout_kernel().expand;
+        constexpr size_t CHUNK_WORDS = 64;
+        // +72: room for the 8-byte reads of expand_ssse3.
+        char gap_buf[CHUNK_WORDS * 64 + 72];
+        std::vector<char> letter_buf;
+        size_t run_pos = 0;  // next encoded run in runs_
+        char run_byte = 0;
+        size_t run_left = 0; // bytes of the current run not yet used
+        size_t li = 0;                // letters taken from continuous
+
+        for (size_t w0 = 0; w0 < mask_.size(); w0 += CHUNK_WORDS) {
+            size_t w1 = std::min(mask_.size(), w0 + CHUNK_WORDS);
+            size_t begin = w0 * 64, end = std::min(size_, w1 * 64);
+            size_t need_letters = 0;
+            for (size_t w = w0; w < w1; ++w) need_letters += static_cast<size_t>(__builtin_popcountll(mask_[w]));
+            size_t need_gaps = end - begin - need_letters;
+
+            for (size_t filled = 0; filled < need_gaps;) {
+                if (run_left == 0) run_pos = read_run(run_pos, run_byte, run_left);
+                size_t take = std::min(need_gaps - filled, run_left);
+                std::memset(gap_buf + filled, run_byte, take);
+                filled += take;
+                run_left -= take;
+            }
+
+            // Letters straight from continuous, or padded with 'X' once it ends.
+            const char* src = continuous.data() + li;
+            size_t avail = continuous.size() - li;
+            if (avail < need_letters) {
+                letter_buf.assign(need_letters, 'X');
+                std::memcpy(letter_buf.data(), src, avail);
+                src = letter_buf.data();
+                avail = need_letters;
+            }
+
+            // Whole words in bulk; the word holding the end of the text bit by bit.
+            size_t full = (end - begin) / 64;
+            size_t lj = 0, gj = 0;
+            size_t w = expand ? expand(mask_.data() + w0, full, src, avail, gap_buf, out + begin, lj, gj) : 0;
+            for (; w0 + w < w1; ++w) {
+                size_t at = begin + w * 64;
+                expand_word_scalar(mask_[w0 + w], std::min<size_t>(64, end - at), src, lj, gap_buf, gj, out + at);
+            }
+            li = std::min(continuous.size(), li + need_letters);
+        }
+        if (li < continuous.size()) std::memcpy(out + size_, continuous.data() + li, continuous.size() - li);
+    }
+
+private:
+    // A run is its byte followed by its length as a LEB128 varint, so a
+    // lone punctuation mark costs two bytes.
+    void append_run(char byte, size_t count) {
+        runs_.push_back(static_cast<uint8_t>(byte));
+        for (; count >= 0x80; count >>= 7) runs_.push_back(static_cast<uint8_t>(count | 0x80));
+        runs_.push_back(static_cast<uint8_t>(count));
+        ++run_count_;
+    }
+
+    size_t read_run(size_t pos, char& byte, size_t& count) const {
+        byte = static_cast<char>(runs_[pos++]);
+        count = 0;
+        for (int shift = 0;; shift += 7) {
+            uint8_t b = runs_[pos++];
+            count |= static_cast<size_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return pos;
+        }
+    }
+
+    size_t size_ = 0;
+    size_t letters_ = 0;
+    size_t run_count_ = 0;
+    std::vector<uint64_t> mask_;
+    std::vector<uint8_t> runs_;
+};
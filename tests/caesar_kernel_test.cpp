@@ -0,0 +1,97 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../is/exp3/caesar_kernel.hpp"
+using namespace std;
+
+// caesarShift (whatever kernel this CPU dispatches to) and every SIMD
+// kernel the CPU supports must match caesarShiftScalar byte for byte: every
+// key, lengths around the 16/32/64-byte vector tails, every byte value at
+// every position within a vector, misaligned input, and in-place output.
+
+static int failures = 0;
+
+static void check(const char *what, const string &in, const string &got, int key, size_t offset) {
+    string want(in.size(), '\0');
+    caesarShiftScalar(in.data(), &want[0], in.size(), normalizeKey(key));
+    if (got == want) return;
+    size_t i = 0;
+    while (got[i] == want[i]) ++i;
+    if (++failures <= 20) {
+        printf("FAIL %s key %d length %zu offset %zu: byte %zu (0x%02x) gave 0x%02x, expected 0x%02x\n", what, key,
+               in.size(), offset, i, static_cast<unsigned char>(in[i]), static_cast<unsigned char>(got[i]),
+               static_cast<unsigned char>(want[i]));
+    }
+}
+
+// One bulk kernel: its prefix, then the scalar tail, as caesarShift does.
+static void checkKernel(const char *name, CaesarShiftFn shift, const string &in, int key, size_t offset) {
+    string got(in.size(), '\0');
+    size_t done = shift(in.data(), &got[0], in.size(), normalizeKey(key));
+    if (done > in.size()) {
+        if (++failures <= 20) printf("FAIL %s claims %zu of %zu bytes\n", name, done, in.size());
+        return;
+    }
+    caesarShiftScalar(in.data() + done, &got[done], in.size() - done, normalizeKey(key));
+    check(name, in, got, key, offset);
+}
+
+int main() {
+    vector<pair<const char *, CaesarShiftFn>> kernels;
+#ifdef CAESAR_KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) kernels.push_back({"sse2", &caesarShiftSSE2});
+    if (__builtin_cpu_supports("avx2")) kernels.push_back({"avx2", &caesarShiftAVX2});
+    if (__builtin_cpu_supports("avx512bw")) kernels.push_back({"avx512", &caesarShiftAVX512});
+#endif
+    printf("dispatch: %s; kernels checked directly:", caesarKernel().name);
+    for (const auto &k : kernels) printf(" %s", k.first);
+    printf("\n");
+
+    // All 256 byte values, rotated so each one lands in every lane.
+    string bytes(256, '\0');
+    for (int c = 0; c < 256; ++c) bytes[c] = static_cast<char>(c);
+    vector<size_t> lengths;
+    for (size_t n = 0; n <= 130; ++n) lengths.push_back(n);
+    for (size_t n : {191, 192, 193, 255, 256, 257, 1000, 4099}) lengths.push_back(n);
+
+    for (int key = -27; key <= 52; ++key) {
+        for (size_t n : lengths) {
+            for (size_t offset = 0; offset < 64; offset += (n > 130 ? 63 : 7)) {
+                string in(n, '\0');
+                for (size_t i = 0; i < n; ++i) in[i] = bytes[(i + offset * 5 + static_cast<size_t>(key) * 3) & 255];
+                // Misaligned source: the string's data plus offset % 16.
+                string padded(offset % 16, '#');
+                padded += in;
+                string got(n, '\0');
+                caesarShift(padded.data() + offset % 16, &got[0], n, key);
+                check("caesarShift", in, got, key, offset);
+
+                string inPlace = in;
+                caesarShiftInPlace(inPlace, key);
+                check("caesarShiftInPlace", in, inPlace, key, offset);
+                check("caesarShift(string)", in, caesarShift(in, key), key, offset);
+                for (const auto &k : kernels) checkKernel(k.first, k.second, in, key, offset);
+            }
+        }
+    }
+
+    // shiftChar itself against the original rule.
+    for (int key = 0; key < 26; ++key) {
+        for (int c = 0; c < 256; ++c) {
+            char want = static_cast<char>(c);
+            if (c >= 'a' && c <= 'z') want = static_cast<char>('a' + (c - 'a' + key) % 26);
+            if (c >= 'A' && c <= 'Z') want = static_cast<char>('A' + (c - 'A' + key) % 26);
+            if (shiftChar(static_cast<char>(c), key) != want && ++failures <= 20) {
+                printf("FAIL shiftChar key %d byte 0x%02x\n", key, c);
+            }
+        }
+    }
+
+    if (failures) {
+        printf("%d mismatches\n", failures);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../is/exp3/caesar_kernel.hpp"
+#include "../is/exp3/crib_search.hpp"
+using namespace std;
+
+// findCribs must report exactly the matches of one streaming pass over the
+// whole text, each once, in the same order: however the text is cut into
+// CRIB_SEARCH_RANGE ranges (with and without a pool) and into the
+// windows casesar_scowl searches a mapped file in, with a planted crib
+// split by a range boundary and by a window boundary after each byte.
+
+static int failures = 0;
+
+static bool sameMatch(const CribMatch &a, const CribMatch &b) {
+    return a.offset == b.offset && a.crib == b.crib && a.key == b.key;
+}
+
+// Matches of want whose last byte falls in [begin, end).
+static vector<CribMatch> endingIn(const CribAutomaton &ac, const vector<CribMatch> &want, size_t begin, size_t end) {
+    vector<CribMatch> out;
+    for (const CribMatch &m : want) {
+        size_t last = m.offset + ac.cribs()[m.crib].size() - 1;
+        if (last >= begin && last < end) out.push_back(m);
+    }
+    return out;
+}
+
+static void check(const char *what, size_t a, size_t b, const vector<CribMatch> &got, const vector<CribMatch> &want) {
+    size_t i = 0;
+    while (i < got.size() && i < want.size() && sameMatch(got[i], want[i])) ++i;
+    if (i == got.size() && i == want.size()) return;
+    if (++failures <= 20) {
+        printf("FAIL %s (%zu, %zu): %zu matches, expected %zu; first difference at match %zu", what, a, b, got.size(),
+               want.size(), i);
+        if (i < want.size()) printf(" (expected crib %u key %d at %llu)", want[i].crib, want[i].key,
+                                    static_cast<unsigned long long>(want[i].offset));
+        printf("\n");
+    }
+}
+
+int main() {
+    const vector<string> cribs = {"attack at dawn", "the", " secret ", "zebra"};
+    CribAutomaton ac(cribs);
+    const size_t span = ac.maxLength();
+
+    // Letters with some spaces and punctuation, from a fixed LCG.
+    string text(2 * CRIB_SEARCH_RANGE + 4099, ' ');
+    uint64_t state = 12345;
+    for (char &c : text) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        unsigned r = static_cast<unsigned>(state >> 33) % 32;
+        c = r < 26 ? static_cast<char>('a' + r) : " .,'\n!"[r - 26];
+    }
+    // Enciphered cribs straddling both range boundaries of the whole text,
+    // and one at a fixed spot that the range and window boundaries below
+    // are moved across.
+    const string first = caesarShift(cribs[0], 3), second = caesarShift(cribs[2], 11);
+    text.replace(CRIB_SEARCH_RANGE - first.size() / 2, first.size(), first);
+    text.replace(2 * CRIB_SEARCH_RANGE - second.size() / 2, second.size(), second);
+    const size_t at = CRIB_SEARCH_RANGE + CRIB_SEARCH_RANGE / 2;
+    const int atKey = 7;
+    string moved = caesarShift(cribs[0], atKey);
+    text.replace(at, moved.size(), moved);
+
+    vector<CribMatch> want;
+    ac.scan(text.data(), text.size(), CribAutomaton::ROOT, 0, [&want](const CribMatch &m) { want.push_back(m); });
+    printf("%zu bytes, %zu cribs (longest %zu), %zu matches\n", text.size(), cribs.size(), span, want.size());
+    auto plantedCount = [&](const vector<CribMatch> &found) {
+        int n = 0;
+        for (const CribMatch &m : found) n += m.offset == at && m.crib == 0 && m.key == atKey;
+        return n;
+    };
+    if (plantedCount(want) != 1 && ++failures <= 20) printf("FAIL reference scan misses the planted crib\n");
+
+    WorkStealingPool pool(4);
+
+    // Whole text, serially and in parallel ranges.
+    check("findCribs", 0, text.size(), findCribs(ac, text.data(), 0, text.size()), want);
+    check("findCribs pool", 0, text.size(), findCribs(ac, text.data(), 0, text.size(), &pool), want);
+
+    // Split the planted crib after each of its bytes: once by a range
+    // boundary (begin moves so one lands there), once by a window boundary
+    // (two calls meeting there). Either way it is found exactly once.
+    for (size_t split = 1; split < span; ++split) {
+        size_t cut = at + split;
+        size_t begin = cut - CRIB_SEARCH_RANGE, end = cut + CRIB_SEARCH_RANGE / 2;
+        vector<CribMatch> got = findCribs(ac, text.data(), begin, end, &pool);
+        check("range split", begin, end, got, endingIn(ac, want, begin, end));
+        if (plantedCount(got) != 1 && ++failures <= 20) {
+            printf("FAIL range split %zu: planted crib found %d times\n", split, plantedCount(got));
+        }
+
+        vector<CribMatch> before = findCribs(ac, text.data(), cut - 4096, cut, &pool);
+        vector<CribMatch> after = findCribs(ac, text.data(), cut, cut + 4096, &pool);
+        check("window before", cut - 4096, cut, before, endingIn(ac, want, cut - 4096, cut));
+        check("window after", cut, cut + 4096, after, endingIn(ac, want, cut, cut + 4096));
+        if (plantedCount(before) + plantedCount(after) != 1 && ++failures <= 20) {
+            printf("FAIL window split %zu: planted crib found %d times\n", split,
+                   plantedCount(before) + plantedCount(after));
+        }
+    }
+
+    // Windows as casesar_scowl cuts a mapped file: consecutive [off, end)
+    // calls, sizes that do and do not line up with the ranges.
+    for (size_t window : {size_t{4093}, CRIB_SEARCH_RANGE / 2 + 1, CRIB_SEARCH_RANGE + 12345}) {
+        vector<CribMatch> got;
+        for (size_t off = 0; off < text.size(); off += window) {
+            size_t end = min(text.size(), off + window);
+            vector<CribMatch> part = findCribs(ac, text.data(), off, end, &pool);
+            got.insert(got.end(), part.begin(), part.end());
+        }
+        check("windows joined", window, text.size(), got, want);
+    }
+
+    if (failures) {
+        printf("%d mismatches\n", failures);
+        return 1;
+    }
+    printf("OK\n");
+    return 0;
+}
@@ -0,0 +1,64 @@
+#!/bin/sh
+# exp4 --encrypt | exp4 --decrypt must give back the input's letters
+# (upper-cased, then padding), whether the ciphertext arrives bare, with a
+# trailing newline or with line breaks, through pipes or mapped files, on
+# one thread or several.
+#
+#   exp4_roundtrip.sh path/to/exp4 scratch-dir
+set -eu
+exp4=$1
+dir=$2
+mkdir -p "$dir"
+fail=0
+
+# expect NAME PLAINTEXT-FILE DECRYPTED-FILE
+expect() {
+    letters=$(tr -cd 'A-Za-z' < "$2" | tr 'a-z' 'A-Z' | wc -c)
+    padded=$(( (letters + 3) / 4 * 4 ))
+    got=$(wc -c < "$3")
+    if [ "$got" -ne "$padded" ]; then
+        echo "FAIL $1: $got bytes decrypted, expected $padded"
+        fail=1
+    elif ! tr -cd 'A-Za-z' < "$2" | tr 'a-z' 'A-Z' | cmp -s - "$3" -n "$letters"; then
+        echo "FAIL $1: decrypted letters differ from the plaintext"
+        fail=1
+    else
+        echo "ok   $1"
+    fi
+}
+
+printf 'Attack at dawn, then retreat!\n' > "$dir/short.txt"
+"$exp4" --encrypt --keyword KEYWORD < "$dir/short.txt" | "$exp4" --decrypt --keyword KEYWORD > "$dir/short.dec"
+expect "pipe" "$dir/short.txt" "$dir/short.dec"
+
+{ "$exp4" --encrypt --keyword KEYWORD < "$dir/short.txt"; echo; } | "$exp4" --decrypt --keyword KEYWORD > "$dir/short.dec"
+expect "pipe, ciphertext ends in a newline" "$dir/short.txt" "$dir/short.dec"
+
+# Several mapped chunks (1 MiB minimum each), ciphertext wrapped in lines.
+i=0
+: > "$dir/big.txt"
+while [ $i -lt 16 ]; do
+    cat "$dir/short.txt" "$dir/short.txt" "$dir/short.txt" "$dir/short.txt" >> "$dir/big.txt"
+    cat "$dir/big.txt" "$dir/big.txt" > "$dir/big.tmp" && mv "$dir/big.tmp" "$dir/big.txt"
+    [ "$(wc -c < "$dir/big.txt")" -gt 4000000 ] && break
+    i=$((i + 1))
+done
+printf 'odd tail' >> "$dir/big.txt"
+"$exp4" --encrypt --keyword KEYWORD --threads 4 --in "$dir/big.txt" --out "$dir/big.enc"
+fold -w 61 "$dir/big.enc" > "$dir/big.wrapped"
+"$exp4" --decrypt --keyword KEYWORD --threads 4 --in "$dir/big.wrapped" --out "$dir/big.dec"
+expect "files, 4 threads, wrapped ciphertext" "$dir/big.txt" "$dir/big.dec"
+"$exp4" --decrypt --keyword KEYWORD --threads 1 < "$dir/big.wrapped" > "$dir/big.dec1"
+if cmp -s "$dir/big.dec" "$dir/big.dec1"; then echo "ok   1 thread matches 4"; else echo "FAIL 1 thread differs from 4"; fail=1; fi
+
+# Writing over the (mapped) input must be refused, not truncate it.
+cp "$dir/short.txt" "$dir/same.txt"
+if "$exp4" --encrypt --keyword KEYWORD --in "$dir/same.txt" --out "$dir/same.txt" 2>/dev/null; then
+    echo "FAIL --in and --out the same file was accepted"; fail=1
+elif ! cmp -s "$dir/short.txt" "$dir/same.txt"; then
+    echo "FAIL --in and --out the same file damaged the input"; fail=1
+else
+    echo "ok   --in and --out the same file refused"
+fi
+
+exit $fail